@@ -0,0 +1,319 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// default chunk size
+#define ARENA_CHUNK_SIZE	(64 * 1024)
+
+// memory chunk
+struct str_arena_chunk {
+	struct str_arena_chunk* next;
+	size_t size;
+	char data[];
+};
+
+typedef struct str_arena_chunk chunk;
+
+// chunk memory comes from the allocator that was in effect when the arena was initialised
+static
+chunk* chunk_alloc(const str_arena* const arena, const size_t n) {
+	const str_allocator* const a = arena->parent;
+	chunk* const c = a ? a->alloc(a->ctx, sizeof(chunk) + n) : malloc(sizeof(chunk) + n);
+
+	if(!c)
+		mem_failure();
+
+	STATS_LIVE(sizeof(chunk) + n);
+	c->size = n;
+	return c;
+}
+
+static
+void chunk_free_list(const str_arena* const arena, chunk* c) {
+	const str_allocator* const a = arena->parent;
+
+	while(c) {
+		chunk* const next = c->next;
+
+		STATS_LIVE(-(int64_t)(sizeof(chunk) + c->size));
+
+		if(a)
+			a->free(a->ctx, c);
+		else
+			free(c);
+
+		c = next;
+	}
+}
+
+static
+void add_chunk(str_arena* const arena, const size_t size) {
+	chunk* c = arena->spare;
+
+	if(c && c->size >= size)
+		arena->spare = c->next;
+	else
+		c = chunk_alloc(arena, (size > arena->chunk_size) ? size : arena->chunk_size);
+
+	if(!arena->head)
+		arena->first = c;
+
+	c->next = arena->head;
+	arena->head = c;
+	arena->ptr = c->data;
+	arena->end = c->data + c->size;
+}
+
+// each allocation is preceded by its size
+static inline
+size_t alloc_size(const size_t n) {
+	if(n > SIZE_MAX - 2 * sizeof(size_t))
+		mem_failure();
+
+	return (sizeof(size_t) + n + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+}
+
+// allocator interface
+void* arena_alloc(void* ctx, size_t n) {
+	str_arena* const arena = ctx;
+	const size_t size = alloc_size(n);
+
+	if((size_t)(arena->end - arena->ptr) < size)
+		add_chunk(arena, size);
+
+	size_t* const h = (size_t*)arena->ptr;
+
+	*h = n;
+	arena->last = arena->ptr;
+	arena->ptr += size;
+
+	return h + 1;
+}
+
+static
+void* arena_realloc(void* ctx, void* p, size_t n) {
+	if(!p)
+		return arena_alloc(ctx, n);
+
+	str_arena* const arena = ctx;
+	size_t* const h = (size_t*)p - 1;
+
+	// resize the last allocation in place
+	if((char*)h == arena->last) {
+		const size_t size = alloc_size(n);
+
+		if(size <= (size_t)(arena->end - arena->last)) {
+			*h = n;
+			arena->ptr = arena->last + size;
+			return p;
+		}
+	}
+
+	// move
+	void* const pp = arena_alloc(ctx, n);
+
+	return memcpy(pp, p, (*h < n) ? *h : n);
+}
+
+static
+void arena_free(void* ctx, void* p) {
+	str_arena* const arena = ctx;
+	char* const h = (char*)((size_t*)p - 1);
+
+	// only the last allocation can be given back
+	if(h == arena->last) {
+		arena->ptr = h;
+		arena->last = NULL;
+	}
+}
+
+// allocation failures are reported to the allocator the chunks come from
+static
+void arena_failure(void* ctx) {
+	const str_allocator* const a = ((str_arena*)ctx)->parent;
+
+	if(a && a->failure)
+		a->failure(a->ctx);
+}
+
+// arena management
+void str_arena_init(str_arena* const arena, const size_t chunk_size) {
+	STATS_CALL(str_arena_init, 0);
+
+	*arena = (str_arena){
+		.chunk_size = chunk_size ? chunk_size : ARENA_CHUNK_SIZE,
+		.parent = str_get_allocator(),
+		.allocator = {
+			.alloc = arena_alloc,
+			.realloc = arena_realloc,
+			.free = arena_free,
+			.failure = arena_failure,
+			.ctx = arena
+		}
+	};
+}
+
+void str_arena_reset(str_arena* const arena) {
+	STATS_CALL(str_arena_reset, 0);
+
+	if(arena->head) {
+		arena->first->next = arena->spare;
+		arena->spare = arena->head;
+		arena->head = arena->first = NULL;
+	}
+
+	arena->ptr = arena->end = arena->last = NULL;
+}
+
+void str_arena_free(str_arena* const arena) {
+	STATS_CALL(str_arena_free, 0);
+
+	chunk_free_list(arena, arena->head);
+	chunk_free_list(arena, arena->spare);
+
+	arena->head = arena->first = arena->spare = NULL;
+	arena->ptr = arena->end = arena->last = NULL;
+}
+
+// operations are run with the arena installed as the thread allocator, so that their
+// results are allocated from the arena, and then converted to references
+static
+const str_allocator* arena_enter(str_arena* const arena) {
+	const str_allocator* const prev = mem_thread_allocator;
+
+	mem_thread_allocator = &arena->allocator;
+	return prev;
+}
+
+static inline
+void arena_leave(const str_allocator* const prev) {
+	mem_thread_allocator = prev;
+}
+
+void str_arena_clone(str_arena* const arena, str* const dest, const str s) {
+	STATS_CALL_STR(str_arena_clone, str_len(s), dest);
+
+	const str_allocator* const prev = arena_enter(arena);
+	str res = str_null;
+
+	str_clone(&res, s);
+	arena_leave(prev);
+	str_assign(dest, str_ref(res));
+}
+
+void str_arena_concat_array(str_arena* const arena, str* const dest, const str* array, const size_t count) {
+	STATS_CALL_STR(str_arena_concat_array, array ? calc_total_length(array, count) : 0, dest);
+
+	const str_allocator* const prev = arena_enter(arena);
+	str res = str_null;
+
+	str_concat_array(&res, array, count);
+	arena_leave(prev);
+	str_assign(dest, str_ref(res));
+}
+
+void str_arena_join_array(str_arena* const arena, str* const dest, const str sep, const str* array, size_t count) {
+	STATS_CALL_STR(str_arena_join_array, array ? calc_total_length(array, count) : 0, dest);
+
+	const str_allocator* const prev = arena_enter(arena);
+	str res = str_null;
+
+	str_join_array(&res, sep, array, count);
+	arena_leave(prev);
+	str_assign(dest, str_ref(res));
+}
+
+bool str_arena_sprintf(str_arena* const arena, str* const dest, const char* const fmt, ...) {
+	STATS_CALL_STR(str_arena_sprintf, 0, dest);
+
+	const str_allocator* const prev = arena_enter(arena);
+	str res = str_null;
+	va_list ap;
+
+	va_start(ap, fmt);
+
+	const bool ok = sprintf_impl(&res, fmt, ap);
+
+	va_end(ap);
+	arena_leave(prev);
+
+	if(ok)
+		str_assign(dest, str_ref(res));
+
+	return ok;
+}
+
+size_t str_arena_replace_substring(str_arena* const arena, str* const dest, const str patt, const str repl) {
+	STATS_CALL_STR(str_arena_replace_substring, str_len(*dest), dest);
+
+	const str_allocator* const prev = arena_enter(arena);
+	str res = str_ref(*dest);
+	const size_t n = str_replace_substring(&res, patt, repl);
+
+	arena_leave(prev);
+
+	if(n > 0)
+		str_assign(dest, str_ref(res));
+
+	return n;
+}
+
+size_t str_arena_replace_chars(str_arena* const arena, str* const dest, const str charset, const str repl) {
+	STATS_CALL_STR(str_arena_replace_chars, str_len(*dest), dest);
+
+	const str_allocator* const prev = arena_enter(arena);
+	str res = str_ref(*dest);
+	const size_t n = str_replace_chars(&res, charset, repl);
+
+	arena_leave(prev);
+
+	if(n > 0)
+		str_assign(dest, str_ref(res));
+
+	return n;
+}
+
+size_t str_arena_replace_char_spans(str_arena* const arena, str* const dest, const str charset, const str repl) {
+	STATS_CALL_STR(str_arena_replace_char_spans, str_len(*dest), dest);
+
+	const str_allocator* const prev = arena_enter(arena);
+	str res = str_ref(*dest);
+	const size_t n = str_replace_char_spans(&res, charset, repl);
+
+	arena_leave(prev);
+
+	if(n > 0)
+		str_assign(dest, str_ref(res));
+
+	return n;
+}
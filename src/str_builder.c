@@ -0,0 +1,102 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// minimal capacity of a non-empty builder
+#define SB_MIN_CAP	64
+
+void str_builder_free(str_builder* const sb) {
+	STATS_CALL(str_builder_free, 0);
+
+	mem_free(sb->ptr, sb->cap);
+	*sb = str_builder_null;
+}
+
+void str_builder_reserve(str_builder* const sb, const size_t n) {
+	STATS_CALL(str_builder_reserve, 0);
+
+	if(n > SIZE_MAX - sb->len - 1)
+		mem_failure();
+
+	const size_t need = sb->len + n + 1;	// +1 for null terminator
+
+	if(need <= sb->cap)
+		return;
+
+	// geometric growth
+	size_t cap = (sb->cap > SB_MIN_CAP / 2) ? (2 * sb->cap) : SB_MIN_CAP;
+
+	if(cap < need)
+		cap = need;
+
+	sb->ptr = mem_realloc(sb->ptr, sb->cap, cap);
+	sb->cap = cap;
+}
+
+void str_builder_append_mem(str_builder* const sb, const char* const s, const size_t n) {
+	STATS_CALL(str_builder_append_mem, n);
+
+	if(n > 0) {
+		str_builder_reserve(sb, n);
+		memcpy(sb->ptr + sb->len, s, n);
+		sb->len += n;
+	}
+}
+
+size_t str_builder_append_codepoint(str_builder* const sb, const uint32_t cp) {
+	STATS_CALL(str_builder_append_codepoint, 0);
+
+	str_builder_reserve(sb, 4);
+
+	const size_t n = str_encode_codepoint(sb->ptr + sb->len, cp);
+
+	sb->len += n;
+	return n;
+}
+
+void str_builder_finish(str* const dest, str_builder* const sb) {
+	STATS_CALL_STR(str_builder_finish, sb->len, dest);
+
+	if(sb->len == 0) {
+		str_builder_free(sb);
+		str_clear(dest);
+		return;
+	}
+
+	// trim the buffer (shrinking realloc does not normally move the memory)
+	char* const p = (sb->cap > sb->len + 1) ? mem_realloc(sb->ptr, sb->cap, sb->len + 1) : sb->ptr;
+
+	p[sb->len] = 0;
+	str_assign(dest, mem_acquire(p, sb->len));
+	*sb = str_builder_null;
+}
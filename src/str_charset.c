@@ -0,0 +1,348 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// Vectorised set membership test, after the "truffle" algorithm from Hyperscan:
+// the low nibble of each byte selects an entry from one of the two 16-byte tables
+// (`lo` for bytes below 0x80, `hi` for the rest), and the other three bits of the high
+// nibble select a bit within that entry. Both lookups are done with a byte shuffle.
+
+// scalar version
+static
+const char* scan_scalar(const str_charset* const cs, const char* p, const char* const end, const bool member) {
+	while(p < end && (bitset_match(cs, *p) != 0) != member)
+		++p;
+
+	return p;
+}
+
+// reverse scan, returning the pointer past the last byte whose membership equals `member`
+static
+const char* rscan_scalar(const str_charset* const cs, const char* const begin, const char* end, const bool member) {
+	while(end > begin && (bitset_match(cs, end[-1]) != 0) != member)
+		--end;
+
+	return end;
+}
+
+// offsets of all members of the set from position `i` of the string `s`, where up to `n`
+// offsets are stored, and the total number is added to `count`
+static inline __attribute__((always_inline))
+size_t collect(unsigned m, const size_t i, size_t* const pos, const size_t n, size_t count) {
+	if(count >= n)
+		return count + __builtin_popcount(m);	// counting only
+
+	for(; m; m &= m - 1) {
+		if(count < n)
+			pos[count] = i + __builtin_ctz(m);
+
+		++count;
+	}
+
+	return count;
+}
+
+static
+size_t find_all_scalar(const str_charset* const cs, const char* const s, size_t i, const size_t len,
+					   size_t* const pos, const size_t n, size_t count) {
+	for(; i < len; ++i) {
+		if(bitset_match(cs, s[i])) {
+			if(count < n)
+				pos[count] = i;
+
+			++count;
+		}
+	}
+
+	return count;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+// SSSE3 version, 16 bytes per step; the result has a bit set for each member of the set
+__attribute__((target("ssse3"), always_inline))
+static inline
+unsigned members_ssse3(const __m128i lo, const __m128i hi, const __m128i v) {
+	const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+
+	// shuffle gives zero for the bytes with the top bit set
+	const __m128i t = _mm_or_si128(_mm_shuffle_epi8(lo, v),
+									_mm_shuffle_epi8(hi, _mm_xor_si128(v, _mm_set1_epi8(-128))));
+
+	const __m128i b = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x07)));
+
+	return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(t, b), _mm_setzero_si128())) ^ 0xFFFF;
+}
+
+__attribute__((target("ssse3")))
+static
+const char* scan_ssse3(const str_charset* const cs, const char* p, const char* const end, const bool member) {
+	const __m128i lo = _mm_loadu_si128((const __m128i*)cs->lo);
+	const __m128i hi = _mm_loadu_si128((const __m128i*)cs->hi);
+	const unsigned invert = member ? 0 : 0xFFFF;
+
+	for(; end - p >= 16; p += 16) {
+		const unsigned m = members_ssse3(lo, hi, _mm_loadu_si128((const __m128i*)p)) ^ invert;
+
+		if(m)
+			return p + __builtin_ctz(m);
+	}
+
+	return scan_scalar(cs, p, end, member);
+}
+
+__attribute__((target("ssse3")))
+static
+const char* rscan_ssse3(const str_charset* const cs, const char* const begin, const char* end, const bool member) {
+	const __m128i lo = _mm_loadu_si128((const __m128i*)cs->lo);
+	const __m128i hi = _mm_loadu_si128((const __m128i*)cs->hi);
+	const unsigned invert = member ? 0 : 0xFFFF;
+
+	for(; end - begin >= 16; end -= 16) {
+		const unsigned m = members_ssse3(lo, hi, _mm_loadu_si128((const __m128i*)(end - 16))) ^ invert;
+
+		if(m)
+			return end - 16 + (32 - __builtin_clz(m));
+	}
+
+	return rscan_scalar(cs, begin, end, member);
+}
+
+// AVX2 version, 32 bytes per step
+__attribute__((target("avx2"), always_inline))
+static inline
+unsigned members_avx2(const __m256i lo, const __m256i hi, const __m256i v) {
+	const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+										  1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+
+	const __m256i t = _mm256_or_si256(_mm256_shuffle_epi8(lo, v),
+									  _mm256_shuffle_epi8(hi, _mm256_xor_si256(v, _mm256_set1_epi8(-128))));
+
+	const __m256i b = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x07)));
+
+	return (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(t, b), _mm256_setzero_si256())) ^ 0xFFFFFFFF;
+}
+
+__attribute__((target("avx2")))
+static
+const char* scan_avx2(const str_charset* const cs, const char* p, const char* const end, const bool member) {
+	const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->lo));
+	const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->hi));
+	const unsigned invert = member ? 0 : 0xFFFFFFFF;
+
+	for(; end - p >= 32; p += 32) {
+		const unsigned m = members_avx2(lo, hi, _mm256_loadu_si256((const __m256i*)p)) ^ invert;
+
+		if(m)
+			return p + __builtin_ctz(m);
+	}
+
+	return (end - p >= 16) ? scan_ssse3(cs, p, end, member) : scan_scalar(cs, p, end, member);
+}
+
+__attribute__((target("avx2")))
+static
+const char* rscan_avx2(const str_charset* const cs, const char* const begin, const char* end, const bool member) {
+	const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->lo));
+	const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->hi));
+	const unsigned invert = member ? 0 : 0xFFFFFFFF;
+
+	for(; end - begin >= 32; end -= 32) {
+		const unsigned m = members_avx2(lo, hi, _mm256_loadu_si256((const __m256i*)(end - 32))) ^ invert;
+
+		if(m)
+			return end - 32 + (32 - __builtin_clz(m));
+	}
+
+	return (end - begin >= 16) ? rscan_ssse3(cs, begin, end, member) : rscan_scalar(cs, begin, end, member);
+}
+
+// sets of up to 3 bytes are matched by comparing against each byte, 16 bytes per step
+__attribute__((target("sse2"), always_inline))
+static inline
+unsigned members_small_sse2(const __m128i c0, const __m128i c1, const __m128i c2, const __m128i v) {
+	const __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, c0), _mm_cmpeq_epi8(v, c1)),
+									_mm_cmpeq_epi8(v, c2));
+
+	return (unsigned)_mm_movemask_epi8(eq);
+}
+
+#define SMALL_SET(cs)	\
+	const __m128i c0 = _mm_set1_epi8((char)(cs)->chars[0]);	\
+	const __m128i c1 = _mm_set1_epi8((char)(cs)->chars[((cs)->n > 1) ? 1 : 0]);	\
+	const __m128i c2 = _mm_set1_epi8((char)(cs)->chars[((cs)->n > 2) ? 2 : 0])
+
+__attribute__((target("sse2")))
+static
+const char* scan_small_sse2(const str_charset* const cs, const char* p, const char* const end, const bool member) {
+	SMALL_SET(cs);
+
+	const unsigned invert = member ? 0 : 0xFFFF;
+
+	for(; end - p >= 16; p += 16) {
+		const unsigned m = members_small_sse2(c0, c1, c2, _mm_loadu_si128((const __m128i*)p)) ^ invert;
+
+		if(m)
+			return p + __builtin_ctz(m);
+	}
+
+	return scan_scalar(cs, p, end, member);
+}
+
+__attribute__((target("sse2")))
+static
+const char* rscan_small_sse2(const str_charset* const cs, const char* const begin, const char* end, const bool member) {
+	SMALL_SET(cs);
+
+	const unsigned invert = member ? 0 : 0xFFFF;
+
+	for(; end - begin >= 16; end -= 16) {
+		const unsigned m = members_small_sse2(c0, c1, c2, _mm_loadu_si128((const __m128i*)(end - 16))) ^ invert;
+
+		if(m)
+			return end - 16 + (32 - __builtin_clz(m));
+	}
+
+	return rscan_scalar(cs, begin, end, member);
+}
+
+// collection of the offsets
+__attribute__((target("ssse3")))
+static
+size_t find_all_ssse3(const str_charset* const cs, const char* const s, size_t i, const size_t len,
+					  size_t* const pos, const size_t n, size_t count) {
+	const __m128i lo = _mm_loadu_si128((const __m128i*)cs->lo);
+	const __m128i hi = _mm_loadu_si128((const __m128i*)cs->hi);
+
+	for(; len - i >= 16; i += 16)
+		count = collect(members_ssse3(lo, hi, _mm_loadu_si128((const __m128i*)(s + i))), i, pos, n, count);
+
+	return find_all_scalar(cs, s, i, len, pos, n, count);
+}
+
+__attribute__((target("avx2,popcnt")))
+static
+size_t find_all_avx2(const str_charset* const cs, const char* const s, size_t i, const size_t len,
+					 size_t* const pos, const size_t n, size_t count) {
+	const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->lo));
+	const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)cs->hi));
+
+	for(; len - i >= 32; i += 32)
+		count = collect(members_avx2(lo, hi, _mm256_loadu_si256((const __m256i*)(s + i))), i, pos, n, count);
+
+	return find_all_ssse3(cs, s, i, len, pos, n, count);
+}
+
+__attribute__((target("sse2")))
+static
+size_t find_all_small_sse2(const str_charset* const cs, const char* const s, size_t i, const size_t len,
+						   size_t* const pos, const size_t n, size_t count) {
+	SMALL_SET(cs);
+
+	for(; len - i >= 16; i += 16)
+		count = collect(members_small_sse2(c0, c1, c2, _mm_loadu_si128((const __m128i*)(s + i))), i, pos, n, count);
+
+	return find_all_scalar(cs, s, i, len, pos, n, count);
+}
+
+// implementation selection
+typedef const char* (*scan_func)(const str_charset* const, const char*, const char* const, const bool);
+
+typedef const char* (*rscan_func)(const str_charset* const, const char* const, const char*, const bool);
+typedef size_t (*find_all_func)(const str_charset* const, const char* const, size_t, const size_t,
+							   size_t* const, const size_t, size_t);
+
+static scan_func scan_impl = scan_scalar;
+static scan_func scan_small_impl = scan_scalar;
+static rscan_func rscan_impl = rscan_scalar;
+static rscan_func rscan_small_impl = rscan_scalar;
+static find_all_func find_all_impl = find_all_scalar;
+static find_all_func find_all_small_impl = find_all_scalar;
+
+__attribute__((constructor))
+static
+void select_scan_impl(void) {
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx2")) {
+		scan_impl = scan_avx2;
+		rscan_impl = rscan_avx2;
+	} else if(__builtin_cpu_supports("ssse3")) {
+		scan_impl = scan_ssse3;
+		rscan_impl = rscan_ssse3;
+	}
+
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+		find_all_impl = find_all_avx2;
+	else if(__builtin_cpu_supports("ssse3"))
+		find_all_impl = find_all_ssse3;
+
+	if(__builtin_cpu_supports("sse2")) {
+		scan_small_impl = scan_small_sse2;
+		rscan_small_impl = rscan_small_sse2;
+		find_all_small_impl = find_all_small_sse2;
+	}
+}
+
+#else	// no SIMD
+
+#define scan_impl			scan_scalar
+#define scan_small_impl		scan_scalar
+#define rscan_impl			rscan_scalar
+#define rscan_small_impl	rscan_scalar
+#define find_all_impl		find_all_scalar
+#define find_all_small_impl	find_all_scalar
+
+#endif
+
+const char* bitset_scan(const str_charset* const cs, const char* p, const char* const end, const bool member) {
+	return (cs->n > 0) ? scan_small_impl(cs, p, end, member) : scan_impl(cs, p, end, member);
+}
+
+const char* bitset_rscan(const str_charset* const cs, const char* const begin, const char* const end, const bool member) {
+	return (cs->n > 0) ? rscan_small_impl(cs, begin, end, member) : rscan_impl(cs, begin, end, member);
+}
+
+size_t bitset_find_all(const str_charset* const cs, const char* const s, const size_t len,
+					   size_t* const pos, const size_t n) {
+	return (cs->n > 0) ? find_all_small_impl(cs, s, 0, len, pos, n, 0) : find_all_impl(cs, s, 0, len, pos, n, 0);
+}
+
+// compiled character set
+void str_charset_init(str_charset* const cs, const str chars) {
+	STATS_CALL(str_charset_init, str_len(chars));
+
+	bitset_init(cs, chars);
+}
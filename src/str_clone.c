@@ -34,10 +34,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // allocate and assign a copy of the given string
 void str_clone(str* const dest, const str s) {
+	STATS_CALL_STR(str_clone, str_len(s), dest);
+
 	const size_t n = str_len(s);
 
 	if(n > 0)
-		str_assign(dest, str_acquire_mem(mem_alloc_copy(s.ptr, n), n));
+		str_assign(dest, mem_acquire(mem_alloc_copy(s.ptr, n), n));
 	else
 		str_clear(dest);
 }
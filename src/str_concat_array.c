@@ -34,6 +34,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // concatenate array of strings
 void str_concat_array(str* const dest, const str* array, const size_t count) {
+	STATS_CALL_STR(str_concat_array, array ? calc_total_length(array, count) : 0, dest);
+
 	// simple cases
 	if(!array || count == 0) {
 		str_clear(dest);
@@ -52,6 +54,19 @@ void str_concat_array(str* const dest, const str* array, const size_t count) {
 		return;
 	}
 
+	// append to the destination string in place, with amortised reallocation
+	if(mem_can_append(*dest, array, count)) {
+		char* const buff = mem_grow(dest, n);
+		char* p = buff + str_len(*array++);
+
+		while(p < buff + n)
+			p = append_str(p, *array++);
+
+		*p = 0;
+		dest->prop = str_growable_prop(n);
+		return;
+	}
+
 	// full concatenation
 	char* const buff = mem_alloc(n + 1);
 	char* p = buff;
@@ -60,5 +75,5 @@ void str_concat_array(str* const dest, const str* array, const size_t count) {
 		p = append_str(p, *array++);
 
 	*p = 0;
-	str_assign(dest, str_acquire_mem(buff, n));
+	str_assign(dest, mem_acquire(buff, n));
 }
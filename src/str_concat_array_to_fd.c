@@ -114,6 +114,8 @@ int write_vec(const int fd, const str* src, const size_t count) {
 }
 
 int str_concat_array_to_fd(const int fd, const str* src, const size_t count) {
+	STATS_CALL(str_concat_array_to_fd, src ? calc_total_length(src, count) : 0);
+
 	switch(count) {
 	case 0:
 		return 0;
@@ -35,6 +35,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <errno.h>
 
 int str_concat_array_to_stream(FILE* const stream, const str* src, const size_t count) {
+	STATS_CALL(str_concat_array_to_stream, src ? calc_total_length(src, count) : 0);
+
 	if(src) {
 		for(const str* p = src; p < src + count; ++p) {
 			const size_t n = str_len(*p);
@@ -0,0 +1,124 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// Byte counting: each block is masked and compared against the value, and the bits of
+// the resulting mask are counted with popcount. The same kernel counts UTF-8 continuation bytes.
+
+// scalar version
+static
+size_t count_scalar(const char* p, const char* const end, const char mask, const char c, size_t count) {
+	for(; p < end; ++p)
+		count += ((*p & mask) == c);
+
+	return count;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+// SSE2 version, 64 bytes per step
+__attribute__((target("sse2,popcnt")))
+static
+size_t count_sse2(const char* p, const char* const end, const char mask, const char c, size_t count) {
+	const __m128i m = _mm_set1_epi8(mask), v = _mm_set1_epi8(c);
+
+#define EQ(i)	_mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128((const __m128i*)(p + (i))), m), v)
+
+	for(; end - p >= 64; p += 64) {
+		const uint64_t m0 = (uint16_t)_mm_movemask_epi8(EQ(0));
+		const uint64_t m1 = (uint16_t)_mm_movemask_epi8(EQ(16));
+		const uint64_t m2 = (uint16_t)_mm_movemask_epi8(EQ(32));
+		const uint64_t m3 = (uint16_t)_mm_movemask_epi8(EQ(48));
+
+		count += __builtin_popcountll(m0 | (m1 << 16) | (m2 << 32) | (m3 << 48));
+	}
+
+#undef EQ
+
+	return count_scalar(p, end, mask, c, count);
+}
+
+// AVX2 version, 64 bytes per step
+__attribute__((target("avx2,popcnt")))
+static
+size_t count_avx2(const char* p, const char* const end, const char mask, const char c, size_t count) {
+	const __m256i m = _mm256_set1_epi8(mask), v = _mm256_set1_epi8(c);
+
+#define EQ(i)	_mm256_cmpeq_epi8(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)(p + (i))), m), v)
+
+	for(; end - p >= 64; p += 64) {
+		const uint64_t m0 = (uint32_t)_mm256_movemask_epi8(EQ(0));
+		const uint64_t m1 = (uint32_t)_mm256_movemask_epi8(EQ(32));
+
+		count += __builtin_popcountll(m0 | (m1 << 32));
+	}
+
+#undef EQ
+
+	return count_scalar(p, end, mask, c, count);
+}
+
+// implementation selection
+static size_t (*count_impl)(const char*, const char* const, const char, const char, size_t) = count_scalar;
+
+__attribute__((constructor))
+static
+void select_count_impl(void) {
+	__builtin_cpu_init();
+
+	if(!__builtin_cpu_supports("popcnt"))
+		return;
+
+	if(__builtin_cpu_supports("avx2"))
+		count_impl = count_avx2;
+	else if(__builtin_cpu_supports("sse2"))
+		count_impl = count_sse2;
+}
+
+#else	// no SIMD
+
+#define count_impl	count_scalar
+
+#endif
+
+size_t mem_count_masked(const char* const p, const char* const end, const char mask, const char c) {
+	return count_impl(p, end, mask, c, 0);
+}
+
+size_t str_count_byte(const str s, const char c) {
+	STATS_CALL(str_count_byte, str_len(s));
+
+	return count_impl(str_ptr(s), str_end(s), (char)0xFF, c, 0);
+}
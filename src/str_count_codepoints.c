@@ -32,20 +32,44 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "str_impl.h"
 
+// Codepoint counting: in valid UTF-8 the number of codepoints equals the number of bytes that are
+// not continuation bytes (10xxxxxx), so the continuation bytes are counted with the byte counting
+// kernel and subtracted. The input is split into the valid spans, counted this way, and the blocks
+// with invalid sequences, processed by the decoder.
+
+size_t utf8_count_starts(const char* const p, const char* const end) {
+	return (end - p) - mem_count_masked(p, end, (char)0xC0, (char)0x80);
+}
+
+// number of bytes processed by the decoder after an invalid sequence
+#define INVALID_BLOCK	64
+
 size_t str_count_codepoints(const str s) {
+	STATS_CALL(str_count_codepoints, str_len(s));
+
 	size_t count = 0;
 	const char* p = str_ptr(s);
 	const char* const end = str_end(s);
-	str_decode_result r = str_decode_utf8(p, end - p);
 
-	while(r.num_bytes > 0) {
-		++count;
+	while(p < end) {
+		// valid span
+		const char* const q = p + utf8_span_valid(p, end - p);
+
+		count += utf8_count_starts(p, q);
+		p = q;
+
+		// invalid block
+		const char* const stop = (end - p > INVALID_BLOCK) ? (p + INVALID_BLOCK) : end;
+
+		while(p < stop) {
+			const str_decode_result r = str_decode_utf8(p, end - p);
 
-		p += (r.status != STR_UTF8_ERROR || r.num_bytes == 1)
-		   ? r.num_bytes
-		   : (r.num_bytes - 1);
+			++count;
 
-		r = str_decode_utf8(p, end - p);
+			p += (r.status != STR_UTF8_ERROR || r.num_bytes == 1)
+			   ? r.num_bytes
+			   : (r.num_bytes - 1);
+		}
 	}
 
 	return count;
@@ -0,0 +1,192 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// Bulk UTF-8 decoding. Each invalid sequence is either decoded as U+FFFD (in the same way as
+// str_to_valid_utf8 replaces it), or stops the decoding. The vectorised version decodes 16 bytes
+// at a time as long as they are ASCII, or form a run of valid 2-byte sequences, and falls back
+// to the scalar decoder for everything else.
+
+void str_utf8_decoder_init(str_utf8_decoder* const dec, const str s, const bool replace) {
+	STATS_CALL(str_utf8_decoder_init, 0);
+
+	dec->base = dec->ptr = str_ptr(s);
+	dec->end = str_end(s);
+	dec->error = str_len(s);
+	dec->replace = replace;
+}
+
+// decode one sequence, returning false at an invalid sequence when not in replacement mode
+static inline
+bool decode_step(str_utf8_decoder* const dec, uint32_t* const cp) {
+	const char* const p = dec->ptr;
+	const str_decode_result r = str_decode_utf8(p, dec->end - p);
+
+	if(r.status == STR_UTF8_OK) {
+		*cp = r.codepoint;
+		dec->ptr = p + r.num_bytes;
+		return true;
+	}
+
+	if(dec->error > (size_t)(p - dec->base))
+		dec->error = p - dec->base;
+
+	if(!dec->replace) {
+		dec->end = p;	// stop here
+		return false;
+	}
+
+	*cp = 0xFFFD;
+	dec->ptr = p + ((r.status == STR_UTF8_INCOMPLETE || r.num_bytes == 1)
+					? r.num_bytes
+					: (r.num_bytes - 1));
+	return true;
+}
+
+// scalar version
+static
+size_t decode_scalar(str_utf8_decoder* const dec, uint32_t* const cps, size_t* const offsets, const size_t n) {
+	size_t i = 0;
+
+	for(; i < n && dec->ptr < dec->end; ++i) {
+		const size_t off = dec->ptr - dec->base;
+
+		if(!decode_step(dec, cps + i))
+			break;
+
+		if(offsets)
+			offsets[i] = off;
+	}
+
+	return i;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+// SSE2 version
+__attribute__((target("sse2")))
+static
+size_t decode_sse2(str_utf8_decoder* const dec, uint32_t* const cps, size_t* const offsets, const size_t n) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+
+	while(i < n && dec->ptr < dec->end) {
+		const char* const p = dec->ptr;
+		const size_t off = p - dec->base;
+
+		if(dec->end - p >= 16 && n - i >= 16) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)p);
+			const unsigned m = (unsigned)_mm_movemask_epi8(v);
+
+			// leading ASCII bytes; all 16 are stored, but only the ASCII ones are counted
+			if((m & 1) == 0) {
+				const size_t k = (m == 0) ? 16 : __builtin_ctz(m);
+				const __m128i lo = _mm_unpacklo_epi8(v, zero);
+				const __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+				_mm_storeu_si128((__m128i*)(cps + i), _mm_unpacklo_epi16(lo, zero));
+				_mm_storeu_si128((__m128i*)(cps + i + 4), _mm_unpackhi_epi16(lo, zero));
+				_mm_storeu_si128((__m128i*)(cps + i + 8), _mm_unpacklo_epi16(hi, zero));
+				_mm_storeu_si128((__m128i*)(cps + i + 12), _mm_unpackhi_epi16(hi, zero));
+
+				if(offsets)
+					for(size_t j = 0; j < k; ++j)
+						offsets[i + j] = off + j;
+
+				i += k;
+				dec->ptr = p + k;
+				continue;
+			}
+
+			// leading 2-byte sequences, as 16-bit lanes with the lead byte in the low half:
+			// the lead byte must be 110xxxxx, but not C0 or C1, and the next one 10xxxxxx
+			const __m128i pair = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xC0E0)),
+												 _mm_set1_epi16((short)0x80C0));
+			const __m128i overlong = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(0x001E)), zero);
+			const unsigned m2 = (unsigned)_mm_movemask_epi8(_mm_andnot_si128(overlong, pair));
+
+			if(m2 & 1) {
+				const size_t k = (m2 == 0xFFFF) ? 8 : (__builtin_ctz(~m2) / 2);
+				const __m128i cp = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x1F)), 6),
+												_mm_and_si128(_mm_srli_epi16(v, 8), _mm_set1_epi16(0x3F)));
+
+				_mm_storeu_si128((__m128i*)(cps + i), _mm_unpacklo_epi16(cp, zero));
+				_mm_storeu_si128((__m128i*)(cps + i + 4), _mm_unpackhi_epi16(cp, zero));
+
+				if(offsets)
+					for(size_t j = 0; j < k; ++j)
+						offsets[i + j] = off + 2 * j;
+
+				i += k;
+				dec->ptr = p + 2 * k;
+				continue;
+			}
+		}
+
+		if(!decode_step(dec, cps + i))
+			break;
+
+		if(offsets)
+			offsets[i] = off;
+
+		++i;
+	}
+
+	return i;
+}
+
+// implementation selection
+static size_t (*decode_impl)(str_utf8_decoder* const, uint32_t* const, size_t* const, const size_t) = decode_scalar;
+
+__attribute__((constructor))
+static
+void select_decode_impl(void) {
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("sse2"))
+		decode_impl = decode_sse2;
+}
+
+#else	// no SIMD
+
+#define decode_impl	decode_scalar
+
+#endif
+
+size_t str_decode_utf8_array(str_utf8_decoder* const dec, uint32_t* const cps, size_t* const offsets, const size_t n) {
+	STATS_CALL(str_decode_utf8_array, dec->end - dec->ptr);
+
+	return decode_impl(dec, cps, offsets, n);
+}
@@ -33,31 +33,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "str_impl.h"
 
 size_t str_encode_codepoint(char* const p, const uint32_t cp) {
-	switch(cp) {
-	case 0 ... 0x7F:
-		p[0] = (char)cp;
-		return 1;
-
-	case 0x80 ... 0x7FF:
-		p[0] = (char)(((cp >> 6) & 0x1F) | 0xC0);
-		p[1] = (char)(((cp >> 0) & 0x3F) | 0x80);
-		return 2;
-
-	case 0x0800 ... 0xD7FF:
-	case 0xE000 ... 0xFFFF:
-		p[0] = (char)(((cp >> 12) & 0x0F) | 0xE0);
-		p[1] = (char)(((cp >>  6) & 0x3F) | 0x80);
-		p[2] = (char)(((cp >>  0) & 0x3F) | 0x80);
-		return 3;
-
-	case 0x10000 ... 0x10FFFF:
-		p[0] = (char)(((cp >> 18) & 0x07) | 0xF0);
-		p[1] = (char)(((cp >> 12) & 0x3F) | 0x80);
-		p[2] = (char)(((cp >>  6) & 0x3F) | 0x80);
-		p[3] = (char)(((cp >>  0) & 0x3F) | 0x80);
-		return 4;
-
-	default:
-		return 0;
-	}
+	STATS_CALL(str_encode_codepoint, 0);
+
+	return utf8_encode(p, cp);
 }
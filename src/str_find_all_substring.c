@@ -0,0 +1,66 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+size_t str_find_all_substring(const str s, const str substr, size_t* const pos, const size_t n) {
+	STATS_CALL(str_find_all_substring, str_len(s));
+
+	if(str_is_empty(s) || str_is_empty(substr))
+		return 0;
+
+	str_finder f;
+
+	str_finder_init(&f, substr);
+
+	return str_finder_find_all(&f, s, pos, n);
+}
+
+size_t str_finder_find_all(const str_finder* const f, const str s, size_t* const pos, const size_t n) {
+	STATS_CALL(str_finder_find_all, str_len(s));
+
+	const size_t len = str_len(s);
+	const size_t step = str_len(f->needle);
+	size_t count = 0;
+
+	if(step == 0)
+		return 0;
+
+	for(size_t i = str_finder_first(f, s); i < len; i = str_finder_next(f, s, i + step)) {
+		if(count < n)
+			pos[count] = i;
+
+		++count;
+	}
+
+	return count;
+}
@@ -0,0 +1,463 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// Substring search. Single byte needles are searched with memchr. Longer needles are searched
+// with a vectorised filter on two rare bytes of the needle, where each candidate position is
+// verified with memcmp. If the filter turns out to be ineffective on the given input, the search
+// switches over to the Two-Way algorithm, which guarantees linear time. Without SIMD support
+// only the Two-Way algorithm is used.
+
+// approximate frequency rank of a byte in typical text (higher is more frequent)
+static
+unsigned byte_rank(const uint8_t c) {
+	static const char common[] = " etaoinsrhldcumfpgwybvkxjqz";
+
+	const char* const p = memchr(common, c, sizeof(common) - 1);
+
+	if(p)
+		return 255 - (p - common);
+
+	if((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+		return 200;
+
+	if(c == '\n' || c == '\t' || c == '\r' || (c >= 0x21 && c <= 0x7E))
+		return 180;
+
+	if(c >= 0x80 && c <= 0xBF)	// UTF-8 continuation bytes
+		return 120;
+
+	return (c >= 0xC0) ? 100 : 60;
+}
+
+// Two-Way algorithm (see https://www-igm.univ-mlv.fr/~mac/Articles-PDF/CP-1991-jacm.pdf
+// and musl's strstr), with the reverse search done on the mirrored needle and haystack
+static inline
+uint8_t at(const char* const s, const size_t len, const size_t i, const bool rev) {
+	return (uint8_t)s[rev ? (len - 1 - i) : i];
+}
+
+// critical factorisation of the needle
+static
+void two_way_init(const char* const n, const size_t l, const bool rev,
+				  size_t* const split, size_t* const period, size_t* const mem) {
+	size_t ip, jp, k, p, ms, p0;
+
+	// maximal suffix
+	ip = -1; jp = 0; k = p = 1;
+
+	while(jp + k < l) {
+		const uint8_t a = at(n, l, ip + k, rev), b = at(n, l, jp + k, rev);
+
+		if(a == b) {
+			if(k == p) {
+				jp += p;
+				k = 1;
+			} else
+				++k;
+		} else if(a > b) {
+			jp += k;
+			k = 1;
+			p = jp - ip;
+		} else {
+			ip = jp++;
+			k = p = 1;
+		}
+	}
+
+	ms = ip;
+	p0 = p;
+
+	// same with the opposite comparison
+	ip = -1; jp = 0; k = p = 1;
+
+	while(jp + k < l) {
+		const uint8_t a = at(n, l, ip + k, rev), b = at(n, l, jp + k, rev);
+
+		if(a == b) {
+			if(k == p) {
+				jp += p;
+				k = 1;
+			} else
+				++k;
+		} else if(a < b) {
+			jp += k;
+			k = 1;
+			p = jp - ip;
+		} else {
+			ip = jp++;
+			k = p = 1;
+		}
+	}
+
+	if(ip + 1 > ms + 1)
+		ms = ip;
+	else
+		p = p0;
+
+	// periodic needle?
+	for(k = 0; k < ms + 1 && at(n, l, k, rev) == at(n, l, k + p, rev); ++k)
+		;
+
+	if(k < ms + 1) {
+		*mem = 0;
+		*period = ((ms > l - ms - 1) ? ms : (l - ms - 1)) + 1;
+	} else {
+		*mem = l - p;
+		*period = p;
+	}
+
+	*split = ms;
+}
+
+// search for the needle in the haystack of length `hl`, starting from position `i` (in the
+// haystack mirrored if `rev`), and return the position of the match, or `hl` if not found
+static inline
+size_t two_way(const str_finder* const f, const char* const h, const size_t hl, size_t i, const bool rev) {
+	const char* const n = f->needle.ptr;
+	const size_t l = str_len(f->needle);
+	const size_t ms = rev ? f->rsplit : f->split;
+	const size_t p = rev ? f->rperiod : f->period;
+	const size_t mem0 = rev ? f->rmem : f->mem;
+	size_t mem = 0;
+
+	while(hl - i >= l) {
+		size_t k;
+
+		// right half
+		for(k = (ms + 1 > mem) ? (ms + 1) : mem; k < l && at(n, l, k, rev) == at(h, hl, i + k, rev); ++k)
+			;
+
+		if(k < l) {
+			i += k - ms;
+			mem = 0;
+			continue;
+		}
+
+		// left half
+		for(k = ms + 1; k > mem && at(n, l, k - 1, rev) == at(h, hl, i + k - 1, rev); --k)
+			;
+
+		if(k <= mem)
+			return i;
+
+		i += p;
+		mem = mem0;
+	}
+
+	return hl;
+}
+
+static
+size_t two_way_forward(const str_finder* const f, const char* const h, const size_t hl, const size_t i) {
+	return two_way(f, h, hl, i, false);
+}
+
+// search backwards for a match that ends at or before position `end`
+static
+size_t two_way_reverse(const str_finder* const f, const char* const h, const size_t end) {
+	const size_t i = two_way(f, h, end, 0, true);
+
+	return (i < end) ? (end - i - str_len(f->needle)) : end;
+}
+
+// verification of a candidate
+static inline
+bool match_at(const str_finder* const f, const char* const p) {
+	return memcmp(p, f->needle.ptr, str_len(f->needle)) == 0;
+}
+
+// the filter is considered ineffective if the candidates are less than this number of bytes
+// apart on average
+#define FILTER_MIN_DISTANCE	16
+#define FILTER_MIN_CANDIDATES	64
+
+// mask of the positions from `p` where both rare bytes match
+typedef unsigned (*block_func)(const str_finder* const, const char* const);
+
+// Scan positions from `i` to `last` inclusive, and return either the position of the first
+// match, or `NOT_FOUND`. If the filter is found to be ineffective, `*fallback` is set, and
+// the position to continue from with the Two-Way algorithm is returned.
+#define NOT_FOUND	((size_t)-1)
+
+static inline __attribute__((always_inline))
+size_t filter_forward(const str_finder* const f, const char* const h, size_t i, const size_t last,
+					  bool* const fallback, const block_func block, const size_t W) {
+	const size_t start = i;
+	size_t cands = 0;
+
+	for(; last + 1 - i >= W; i += W) {
+		for(unsigned m = block(f, h + i); m; m &= m - 1) {
+			const size_t j = i + __builtin_ctz(m);
+
+			if(match_at(f, h + j))
+				return j;
+
+			if(++cands >= FILTER_MIN_CANDIDATES && (j - start) / cands < FILTER_MIN_DISTANCE) {
+				*fallback = true;
+				return j + 1;
+			}
+		}
+	}
+
+	for(; i <= last; ++i)
+		if(h[i + f->rare[0]] == f->needle.ptr[f->rare[0]] && match_at(f, h + i))
+			return i;
+
+	return NOT_FOUND;
+}
+
+// same backwards, for positions from `i` down to 0
+static inline __attribute__((always_inline))
+size_t filter_reverse(const str_finder* const f, const char* const h, const size_t i,
+					  bool* const fallback, const block_func block, const size_t W) {
+	size_t end = i + 1;	// positions before `end` are to be checked
+	size_t cands = 0;
+
+	for(; end >= W; end -= W) {
+		const size_t k = end - W;
+
+		for(unsigned m = block(f, h + k); m; m &= ~(1u << (31 - __builtin_clz(m)))) {
+			const size_t j = k + (31 - __builtin_clz(m));
+
+			if(match_at(f, h + j))
+				return j;
+
+			if(++cands >= FILTER_MIN_CANDIDATES && (i - j) / cands < FILTER_MIN_DISTANCE) {
+				if(j == 0)
+					return NOT_FOUND;
+
+				*fallback = true;
+				return j - 1;
+			}
+		}
+	}
+
+	while(end-- > 0)
+		if(h[end + f->rare[0]] == f->needle.ptr[f->rare[0]] && match_at(f, h + end))
+			return end;
+
+	return NOT_FOUND;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+__attribute__((target("sse2")))
+static inline
+unsigned block_sse2(const str_finder* const f, const char* const p) {
+	const size_t r0 = f->rare[0], r1 = f->rare[1];
+	const __m128i v0 = _mm_loadu_si128((const __m128i*)(p + r0));
+	const __m128i v1 = _mm_loadu_si128((const __m128i*)(p + r1));
+
+	return (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v0, _mm_set1_epi8(f->needle.ptr[r0])),
+													 _mm_cmpeq_epi8(v1, _mm_set1_epi8(f->needle.ptr[r1]))));
+}
+
+__attribute__((target("avx2")))
+static inline
+unsigned block_avx2(const str_finder* const f, const char* const p) {
+	const size_t r0 = f->rare[0], r1 = f->rare[1];
+	const __m256i v0 = _mm256_loadu_si256((const __m256i*)(p + r0));
+	const __m256i v1 = _mm256_loadu_si256((const __m256i*)(p + r1));
+
+	return (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(v0, _mm256_set1_epi8(f->needle.ptr[r0])),
+														   _mm256_cmpeq_epi8(v1, _mm256_set1_epi8(f->needle.ptr[r1]))));
+}
+
+__attribute__((target("sse2")))
+static
+size_t forward_sse2(const str_finder* const f, const char* const h, size_t i, const size_t last, bool* const fallback) {
+	return filter_forward(f, h, i, last, fallback, block_sse2, 16);
+}
+
+__attribute__((target("avx2")))
+static
+size_t forward_avx2(const str_finder* const f, const char* const h, size_t i, const size_t last, bool* const fallback) {
+	return filter_forward(f, h, i, last, fallback, block_avx2, 32);
+}
+
+__attribute__((target("sse2")))
+static
+size_t reverse_sse2(const str_finder* const f, const char* const h, const size_t i, bool* const fallback) {
+	return filter_reverse(f, h, i, fallback, block_sse2, 16);
+}
+
+__attribute__((target("avx2")))
+static
+size_t reverse_avx2(const str_finder* const f, const char* const h, const size_t i, bool* const fallback) {
+	return filter_reverse(f, h, i, fallback, block_avx2, 32);
+}
+
+// implementation selection
+static size_t (*forward_impl)(const str_finder* const, const char* const, size_t, const size_t, bool* const);
+static size_t (*reverse_impl)(const str_finder* const, const char* const, const size_t, bool* const);
+
+__attribute__((constructor))
+static
+void select_filter_impl(void) {
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx2")) {
+		forward_impl = forward_avx2;
+		reverse_impl = reverse_avx2;
+	} else if(__builtin_cpu_supports("sse2")) {
+		forward_impl = forward_sse2;
+		reverse_impl = reverse_sse2;
+	}
+}
+
+#else	// no SIMD
+
+static size_t (*const forward_impl)(const str_finder* const, const char* const, size_t, const size_t, bool* const) = NULL;
+static size_t (*const reverse_impl)(const str_finder* const, const char* const, const size_t, bool* const) = NULL;
+
+#endif
+
+// finder interface
+void str_finder_init(str_finder* const f, const str needle) {
+	STATS_CALL(str_finder_init, str_len(needle));
+
+	const size_t l = str_len(needle);
+
+	*f = (str_finder){ .needle = str_ref(needle) };
+
+	if(l < 2)
+		return;
+
+	// pick two rare bytes at different positions
+	const char* const n = needle.ptr;
+	size_t r0 = 0, r1 = 1;
+
+	if(byte_rank(n[r1]) < byte_rank(n[r0])) {
+		r0 = 1;
+		r1 = 0;
+	}
+
+	for(size_t i = 2; i < l; ++i) {
+		const unsigned rank = byte_rank(n[i]);
+
+		if(rank < byte_rank(n[r0])) {
+			r1 = r0;
+			r0 = i;
+		} else if(rank < byte_rank(n[r1]))
+			r1 = i;
+	}
+
+	f->rare[0] = r0;
+	f->rare[1] = r1;
+
+	// Two-Way parameters
+	two_way_init(n, l, false, &f->split, &f->period, &f->mem);
+	two_way_init(n, l, true, &f->rsplit, &f->rperiod, &f->rmem);
+}
+
+size_t str_finder_next(const str_finder* const f, const str s, size_t pos) {
+	STATS_CALL(str_finder_next, str_len(s));
+
+	const char* const h = str_ptr(s);
+	const size_t hl = str_len(s);
+	const size_t l = str_len(f->needle);
+
+	if(pos > hl || hl - pos < l)
+		return hl;
+
+	switch(l) {
+	case 0:
+		return pos;
+
+	case 1: {
+		const char* const p = memchr(h + pos, f->needle.ptr[0], hl - pos);
+
+		return p ? (size_t)(p - h) : hl;
+	}
+	}
+
+	if(forward_impl) {
+		bool fallback = false;
+
+		pos = forward_impl(f, h, pos, hl - l, &fallback);
+
+		if(!fallback)
+			return (pos != NOT_FOUND) ? pos : hl;
+	}
+
+	return two_way_forward(f, h, hl, pos);
+}
+
+size_t str_finder_first(const str_finder* const f, const str s) {
+	STATS_CALL(str_finder_first, str_len(s));
+
+	return str_finder_next(f, s, 0);
+}
+
+size_t str_finder_last(const str_finder* const f, const str s) {
+	STATS_CALL(str_finder_last, str_len(s));
+
+	const char* const h = str_ptr(s);
+	const size_t hl = str_len(s);
+	const size_t l = str_len(f->needle);
+
+	if(hl < l)
+		return hl;
+
+	switch(l) {
+	case 0:
+		return hl;
+
+	case 1:
+		for(const char* p = h + hl; p > h; )
+			if(*--p == f->needle.ptr[0])
+				return p - h;
+
+		return hl;
+	}
+
+	// the search is limited to matches ending before `end`
+	size_t end = hl;
+
+	if(reverse_impl) {
+		bool fallback = false;
+		const size_t pos = reverse_impl(f, h, hl - l, &fallback);
+
+		if(!fallback)
+			return (pos != NOT_FOUND) ? pos : hl;
+
+		end = pos + l;
+	}
+
+	const size_t i = two_way_reverse(f, h, end);
+
+	return (i < end) ? i : hl;
+}
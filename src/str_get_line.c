@@ -37,12 +37,24 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <errno.h>
 
 int str_get_line(str* const dest, FILE* const stream, const int delim) {
+	STATS_CALL(str_get_line, 0);
+
 	char* line = NULL;
 	size_t size = 0;
 	const ssize_t n = getdelim(&line, &size, delim, stream);
 
 	if(n >= 0) {
-		str_assign(dest, str_acquire_mem(mem_realloc(line, n + 1), n));
+		// the line buffer comes from libc, so it can only be reused with the default allocator
+		if(mem_allocator()) {
+			str_assign(dest, mem_acquire(mem_alloc_copy(line, n), n));
+			free(line);
+		} else {
+			char* const p = realloc(line, n + 1);
+
+			str_assign(dest, str_acquire_mem(p ? p : line, n));
+		}
+
+		STATS_OUTPUT(n);
 		return 0;
 	}
 
@@ -54,5 +54,7 @@ void make_seed(void) { rn_seed = time(NULL) ^ getpid(); }
 
 // hash function
 uint64_t str_hash(const str s) {
+	STATS_CALL(str_hash, str_len(s));
+
 	return hash(str_ptr(s), str_len(s), rn_seed);
 }
@@ -34,31 +34,235 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../str.h"
 
+#include <stdarg.h>
+
 // terminator
 void mem_failure(void) __attribute__((noinline, noreturn));
 
-// memory allocator
+// allocators in effect
+extern const str_allocator* mem_process_allocator;
+extern _Thread_local const str_allocator* mem_thread_allocator;
+
+static inline
+const str_allocator* mem_allocator(void) {
+	const str_allocator* const a = mem_thread_allocator;
+
+	return a ? a : mem_process_allocator;
+}
+
+// statistics
+#ifdef STR_STATS
+
+extern _Thread_local str_stats stats_local;
+extern _Thread_local str_stats_id stats_current;
+
+// only the outermost library call is accounted for, including all the allocations it makes
+typedef struct {
+	str_stats_id id;
+	const str* dest;
+} stats_scope;
+
+static inline
+stats_scope stats_enter(const str_stats_id id, const size_t n, const str* const dest) {
+	if(stats_current != str_stats_other)
+		return (stats_scope){ str_stats_other, NULL };
+
+	str_stats_counters* const c = &stats_local.fn[id];
+
+	++c->calls;
+	c->bytes_in += n;
+	stats_current = id;
+
+	return (stats_scope){ id, dest };
+}
+
+static inline
+void stats_leave(const stats_scope* const scope) {
+	if(scope->id != str_stats_other) {
+		if(scope->dest)
+			stats_local.fn[scope->id].bytes_out += str_len(*scope->dest);
+
+		stats_current = str_stats_other;
+	}
+}
+
+// count a call with `n` bytes of input, and the output string `dest`, if any
+#define STATS_CALL_STR(fn, n, dest)	\
+	const stats_scope stats_scope_ __attribute__((cleanup(stats_leave), unused)) = stats_enter(str_stats_##fn, (n), (dest))
+
+#define STATS_CALL(fn, n)	STATS_CALL_STR(fn, (n), NULL)
+
+// count output bytes of the current call
+#define STATS_OUTPUT(n)	({	\
+	if(stats_scope_.id != str_stats_other)	\
+		stats_local.fn[stats_scope_.id].bytes_out += (n);	\
+})
+
+// count allocations, and track live memory of the blocks owned by allocator `a`
+void stats_alloc(const str_allocator* const a, const size_t n);
+void stats_realloc(const str_allocator* const a, const size_t old_size, const size_t n);
+void stats_free(const str_allocator* const a, const size_t n);
+void stats_live(const int64_t delta);
+
+#define STATS_ALLOC(a, n)	stats_alloc((a), (n))
+#define STATS_REALLOC(a, old_size, n)	stats_realloc((a), (old_size), (n))
+#define STATS_FREE(a, n)	stats_free((a), (n))
+#define STATS_LIVE(delta)	stats_live(delta)
+
+#else	// !STR_STATS
+
+#define STATS_CALL_STR(fn, n, dest)	((void)0)
+#define STATS_CALL(fn, n)	((void)0)
+#define STATS_OUTPUT(n)	((void)0)
+#define STATS_ALLOC(a, n)	((void)(a), (void)(n))
+#define STATS_REALLOC(a, old_size, n)	((void)(a), (void)(old_size), (void)(n))
+#define STATS_FREE(a, n)	((void)(a), (void)(n))
+#define STATS_LIVE(delta)	((void)0)
+
+#endif	// STR_STATS
+
+// memory allocator; every block is preceded by a header recording the allocator it came from
+// (NULL for libc), so that the block is always released by the same allocator no matter which one
+// is in effect at that time; the sizes passed to mem_free and mem_realloc are only used for statistics
+typedef union {
+	const str_allocator* owner;
+	uint64_t align;
+} mem_header;
+
+static inline
+mem_header* mem_header_of(void* const p) { return (mem_header*)p - 1; }
+
+static inline
+void* mem_alloc_from(const str_allocator* const a, const size_t n) {
+	if(n > SIZE_MAX - sizeof(mem_header))
+		mem_failure();
+
+	mem_header* const h = a ? a->alloc(a->ctx, sizeof(mem_header) + n) : malloc(sizeof(mem_header) + n);
+
+	if(!h)
+		mem_failure();
+
+	h->owner = a;
+	return h + 1;
+}
+
 static inline
 void* mem_alloc(const size_t n) {
-	void* const p = malloc(n);
+	const str_allocator* const a = mem_allocator();
 
-	if(p)
-		return p;
+	STATS_ALLOC(a, n);
+	return mem_alloc_from(a, n);
+}
 
-	mem_failure();
+static inline
+void mem_free(void* const p, const size_t size) {
+	if(p) {
+		mem_header* const h = mem_header_of(p);
+		const str_allocator* const a = h->owner;
+
+		STATS_FREE(a, size);
+
+		if(a)
+			a->free(a->ctx, h);
+		else
+			free(h);
+	}
 }
 
 static inline
-void* mem_realloc(void* const p, const size_t n) {
-	void* const pp = realloc(p, n);
+void* mem_realloc(void* const p, const size_t old_size, const size_t n) {
+	if(!p) {
+		const str_allocator* const a = mem_allocator();
+
+		STATS_REALLOC(a, old_size, n);
+		return mem_alloc_from(a, n);
+	}
+
+	mem_header* const h = mem_header_of(p);
+	const str_allocator* const a = h->owner;
 
-	if(pp || n == 0)
-		return pp;
+	STATS_REALLOC(a, old_size, n);
 
-	free(p);
+	if(n > SIZE_MAX - sizeof(mem_header))
+		mem_failure();
+
+	mem_header* const hh = a ? a->realloc(a->ctx, h, sizeof(mem_header) + n) : realloc(h, sizeof(mem_header) + n);
+
+	if(hh)
+		return hh + 1;
+
+	mem_free(p, old_size);
 	mem_failure();
 }
 
+// growable strings are owners with capacity of the buffer derived from the string length
+static inline
+bool str_is_growable(const str s) { return (s.prop & 7) == 3; }
+
+// acquired strings own memory from malloc, without the allocator header
+static inline
+bool str_is_acquired(const str s) { return (s.prop & 7) == 4; }
+
+static inline
+size_t mem_capacity(const size_t len) {
+	size_t cap = 32;
+
+	while(cap < len + 1)
+		cap *= 2;
+
+	return cap;
+}
+
+// shared string header size
+#define SHARE_HEADER_SIZE	sizeof(size_t)
+
+// size of the memory block of an owning string
+static inline
+size_t mem_size(const str s) {
+	switch(s.prop & 7) {
+	case 2:
+		return SHARE_HEADER_SIZE + str_len(s) + 1;
+	case 3:
+		return mem_capacity(str_len(s));
+	default:
+		return str_len(s) + 1;
+	}
+}
+
+// test if the string `s` lies within the memory of string `dest`
+static inline
+bool mem_overlaps(const str dest, const str s) {
+	return !str_is_empty(s) && s.ptr < str_end(dest) && str_end(s) > dest.ptr;
+}
+
+// test if the strings from the array can be appended to `dest` in place, which is when `dest`
+// is an exclusively owned string, the first string of the array is `dest` itself, and none
+// of the other strings points into `dest`
+static inline
+bool mem_can_append(const str dest, const str* array, const size_t count) {
+	if(!str_is_owner(dest) || str_is_shared(dest)
+	   || array[0].ptr != dest.ptr || str_len(array[0]) != str_len(dest))
+		return false;
+
+	for(const str* const end = array + count; ++array < end; )
+		if(mem_overlaps(dest, *array))
+			return false;
+
+	return true;
+}
+
+// make `s` a growable string with enough capacity for `n` bytes, and return its buffer
+char* mem_grow(str* const s, const size_t n);
+
+// arena allocation function, to tell arena allocations from others
+void* arena_alloc(void* ctx, size_t n);
+
+// release shared string
+void mem_release_shared(const str s);
+
+// sprintf implementation taking a list of arguments
+bool sprintf_impl(str* const dest, const char* const fmt, va_list ap);
+
 // allocate memory and copy string with null terminator appended
 static inline
 const char* mem_alloc_copy(const char* const s, const size_t n) {
@@ -68,6 +272,16 @@ const char* mem_alloc_copy(const char* const s, const size_t n) {
 	return p;
 }
 
+// take ownership of memory allocated by the library
+static inline
+str mem_acquire(const char* const s, const size_t n) {
+	if(n > 0)
+		return (str){ s, str_owner_prop(n) };
+
+	mem_free((void*)s, 1);
+	return str_null;
+}
+
 // append to destination and return the end pointer
 static inline
 void* mem_append(void* const dest, const void* const src, const size_t n) {
@@ -93,79 +307,147 @@ size_t calc_total_length(const str* src, const size_t count) {
 }
 
 // set matcher functions
-#define BITSET_BUFF_SIZE (256 / sizeof(uint8_t))
-
 static inline
-void bitset_init(uint8_t* buff, const str charset) {
-	memset(buff, 0, BITSET_BUFF_SIZE);
+void bitset_init(str_charset* const cs, const str charset) {
+	memset(cs, 0, sizeof(str_charset));
 
 	const char* const end = str_end(charset);
+	size_t n = 0;
+
+	for(const char* s = str_ptr(charset); s < end; ++s) {
+		const uint8_t c = (uint8_t)*s;
+
+		if(str_charset_has(cs, c))
+			continue;
+
+		cs->bits[c / 8] |= (1 << (c % 8));
+
+		// low nibble indexes the table, high nibble selects the bit
+		if(c < 0x80)
+			cs->lo[c & 0xF] |= (1 << (c >> 4));
+		else
+			cs->hi[c & 0xF] |= (1 << ((c >> 4) - 8));
+
+		// small sets
+		if(n < sizeof(cs->chars))
+			cs->chars[n] = c;
 
-	for(const char* s = str_ptr(charset); s < end; ++s)
-		buff[(uint8_t)*s / 8] |= (1 << ((uint8_t)*s % 8));
+		++n;
+	}
+
+	cs->n = (n <= sizeof(cs->chars)) ? n : 0;
 }
 
 static inline
-uint8_t bitset_match(const uint8_t* const buff, const char c) {
-	return buff[(uint8_t)c / 8] & (1 << ((uint8_t)c % 8));
+bool bitset_match(const str_charset* const cs, const char c) {
+	return str_charset_has(cs, c);
 }
 
+// vectorised scan for the first byte whose membership in the set equals `member`
+const char* bitset_scan(const str_charset* const cs, const char* p, const char* const end, const bool member);
+
+// same in reverse, returning the pointer past the last such byte, or `begin` if not found
+const char* bitset_rscan(const str_charset* const cs, const char* const begin, const char* const end, const bool member);
+
+// vectorised collection of the offsets of all members of the set in the string `s` of length
+// `len`, storing up to `n` of them in `pos`, and returning the total number of members found
+size_t bitset_find_all(const str_charset* const cs, const char* const s, const size_t len,
+					   size_t* const pos, const size_t n);
+
+// minimal length of the input to use the vectorised scan
+#define BITSET_SCAN_MIN	16
+
 static inline
-const char* bitset_search(const uint8_t* const bitset, const char* p, const char* const end) {
-	while(p < end && !bitset_match(bitset, *p))
+const char* bitset_search(const str_charset* const cs, const char* p, const char* const end) {
+	// single byte search
+	if(cs->n == 1) {
+		const char* const r = memchr(p, cs->chars[0], end - p);
+
+		return r ? r : end;
+	}
+
+	if(end - p >= BITSET_SCAN_MIN)
+		return bitset_scan(cs, p, end, true);
+
+	while(p < end && !bitset_match(cs, *p))
 		++p;
 
 	return p;
 }
 
 static inline
-const char* bitset_span(const uint8_t* const bitset, const char* p, const char* const end) {
-	while(p < end && bitset_match(bitset, *p))
+const char* bitset_span(const str_charset* const cs, const char* p, const char* const end) {
+	if(end - p >= BITSET_SCAN_MIN)
+		return bitset_scan(cs, p, end, false);
+
+	while(p < end && bitset_match(cs, *p))
 		++p;
 
 	return p;
 }
 
-// string builder
-#define SB_SIZE	64
+// reverse search, returning the pointer past the last member of the set, or `begin` if not found
+static inline
+const char* bitset_rsearch(const str_charset* const cs, const char* const begin, const char* end) {
+	if(end - begin >= BITSET_SCAN_MIN)
+		return bitset_rscan(cs, begin, end, true);
 
-typedef struct {
-	size_t count;
-	str buff[SB_SIZE];
-} str_builder;
+	while(end > begin && !bitset_match(cs, end[-1]))
+		--end;
 
-static inline
-void sb_init(str_builder* const self) {
-	self->count = 0;
-	self->buff[0] = str_null;
+	return end;
 }
 
+// reverse span, returning the pointer to the trailing run of members of the set
 static inline
-void sb_inc_index(str_builder* const self) {
-	if(++self->count == SB_SIZE) {
-		str_concat_array(self->buff, self->buff, SB_SIZE);
-		self->count = 1;
-	}
-}
+const char* bitset_rspan(const str_charset* const cs, const char* const begin, const char* end) {
+	if(end - begin >= BITSET_SCAN_MIN)
+		return bitset_rscan(cs, begin, end, false);
 
-static inline
-void sb_append_mem(str_builder* const self, const char* const s, const size_t n) {
-	if(n > 0) {
-		self->buff[self->count] = str_ref_mem(s, n);
-		sb_inc_index(self);
-	}
-}
+	while(end > begin && bitset_match(cs, end[-1]))
+		--end;
 
-static inline
-void sb_append(str_builder* const self, const str s) {
-	if(!str_is_empty(s)) {
-		self->buff[self->count] = str_ref(s);
-		sb_inc_index(self);
-	}
+	return end;
 }
 
+// length of the valid UTF-8 prefix of the `len` bytes at `s`
+size_t utf8_span_valid(const char* const s, const size_t len);
+
+// number of bytes `b` from `p` to `end` where `(b & mask) == c`
+size_t mem_count_masked(const char* const p, const char* const end, const char mask, const char c);
+
+// number of bytes that are not UTF-8 continuation bytes, which for a valid UTF-8 string
+// is the number of codepoints
+size_t utf8_count_starts(const char* const p, const char* const end);
+
+// encode codepoint into UTF-8, returning the number of bytes written, or 0 if the codepoint is invalid
 static inline
-void assign_sb(str* const dest, str_builder* const self) {
-	str_concat_array(self->buff, self->buff, self->count);
-	str_assign(dest, self->buff[0]);
+size_t utf8_encode(char* const p, const uint32_t cp) {
+	switch(cp) {
+	case 0 ... 0x7F:
+		p[0] = (char)cp;
+		return 1;
+
+	case 0x80 ... 0x7FF:
+		p[0] = (char)(((cp >> 6) & 0x1F) | 0xC0);
+		p[1] = (char)(((cp >> 0) & 0x3F) | 0x80);
+		return 2;
+
+	case 0x0800 ... 0xD7FF:
+	case 0xE000 ... 0xFFFF:
+		p[0] = (char)(((cp >> 12) & 0x0F) | 0xE0);
+		p[1] = (char)(((cp >>  6) & 0x3F) | 0x80);
+		p[2] = (char)(((cp >>  0) & 0x3F) | 0x80);
+		return 3;
+
+	case 0x10000 ... 0x10FFFF:
+		p[0] = (char)(((cp >> 18) & 0x07) | 0xF0);
+		p[1] = (char)(((cp >> 12) & 0x3F) | 0x80);
+		p[2] = (char)(((cp >>  6) & 0x3F) | 0x80);
+		p[3] = (char)(((cp >>  0) & 0x3F) | 0x80);
+		return 4;
+
+	default:
+		return 0;
+	}
 }
@@ -34,6 +34,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // join array of strings around a separator
 void str_join_array(str* const dest, const str sep, const str* array, size_t count) {
+	STATS_CALL_STR(str_join_array, array ? calc_total_length(array, count) : 0, dest);
+
 	// simple cases
 	if(str_is_empty(sep)) {
 		str_concat_array(dest, array, count);
@@ -50,8 +52,22 @@ void str_join_array(str* const dest, const str sep, const str* array, size_t cou
 		return;
 	}
 
-	// full join
 	const size_t n = calc_total_length(array, count) + str_len(sep) * (count - 1);
+
+	// append to the destination string in place, with amortised reallocation
+	if(mem_can_append(*dest, array, count) && !mem_overlaps(*dest, sep)) {
+		char* const buff = mem_grow(dest, n);
+		char* p = buff + str_len(*array++);
+
+		while(p < buff + n)
+			p = append_str(append_str(p, sep), *array++);
+
+		*p = 0;
+		dest->prop = str_growable_prop(n);
+		return;
+	}
+
+	// full join
 	char* const buff = mem_alloc(n + 1);
 	char* p = append_str(buff, *array++);
 
@@ -59,5 +75,5 @@ void str_join_array(str* const dest, const str sep, const str* array, size_t cou
 		p = append_str(append_str(p, sep), *array++);
 
 	*p = 0;
-	str_assign(dest, str_acquire_mem(buff, n));
+	str_assign(dest, mem_acquire(buff, n));
 }
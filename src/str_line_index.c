@@ -0,0 +1,167 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// Line index: the offsets of line starts are stored as 32-bit values while the indexed text is
+// shorter than 4GB, and widened to 64-bit values once it grows beyond that. With sampling only
+// the start of every (1 << shift)-th line is stored, and the other lines are found by scanning
+// forward from the nearest stored one.
+
+#define MAX_NARROW	((size_t)UINT32_MAX)
+
+// element size
+static inline
+size_t elem_size(const str_line_index* const idx) {
+	return idx->wide ? sizeof(uint64_t) : sizeof(uint32_t);
+}
+
+// i-th stored offset
+static inline
+size_t start_at(const str_line_index* const idx, const size_t i) {
+	return idx->wide ? ((const uint64_t*)idx->starts)[i] : ((const uint32_t*)idx->starts)[i];
+}
+
+// append offset
+static
+void push(str_line_index* const idx, const size_t off) {
+	if(idx->num_starts == idx->cap) {
+		const size_t cap = idx->cap ? (2 * idx->cap) : 256;
+
+		idx->starts = mem_realloc(idx->starts, idx->cap * elem_size(idx), cap * elem_size(idx));
+		idx->cap = cap;
+	}
+
+	if(idx->wide)
+		((uint64_t*)idx->starts)[idx->num_starts++] = off;
+	else
+		((uint32_t*)idx->starts)[idx->num_starts++] = (uint32_t)off;
+}
+
+// switch to 64-bit offsets
+static
+void widen(str_line_index* const idx) {
+	uint64_t* const p = mem_alloc(idx->cap * sizeof(uint64_t));
+	const uint32_t* const q = idx->starts;
+
+	for(size_t i = 0; i < idx->num_starts; ++i)
+		p[i] = q[i];
+
+	mem_free(idx->starts, idx->cap * sizeof(uint32_t));
+
+	idx->starts = p;
+	idx->wide = true;
+}
+
+// API
+void str_line_index_init(str_line_index* const idx, const unsigned shift) {
+	STATS_CALL(str_line_index_init, 0);
+
+	*idx = (str_line_index){ .shift = shift };
+
+	push(idx, 0);	// the first line
+}
+
+void str_line_index_free(str_line_index* const idx) {
+	STATS_CALL(str_line_index_free, 0);
+
+	mem_free(idx->starts, idx->cap * elem_size(idx));
+	*idx = (str_line_index){ 0 };
+}
+
+// number of offsets collected per call to the scanner
+#define CHUNK_SIZE	512
+
+void str_line_index_update(str_line_index* const idx, const str s) {
+	STATS_CALL(str_line_index_update, str_len(s));
+
+	const size_t len = str_len(s);
+
+	if(len <= idx->len)
+		return;
+
+	if(len > MAX_NARROW && !idx->wide)
+		widen(idx);
+
+	str_charset cs;
+
+	bitset_init(&cs, str_lit("\n"));
+
+	const char* const src = str_ptr(s);
+	const size_t mask = ((size_t)1 << idx->shift) - 1;
+	size_t offs[CHUNK_SIZE];
+
+	for(size_t i = idx->len; i < len; i += CHUNK_SIZE) {
+		const size_t n = (len - i < CHUNK_SIZE) ? (len - i) : CHUNK_SIZE;
+		const size_t k = bitset_find_all(&cs, src + i, n, offs, CHUNK_SIZE);
+
+		for(size_t j = 0; j < k; ++j)
+			if((++idx->num_breaks & mask) == 0)
+				push(idx, i + offs[j] + 1);
+
+		if(k > 0)
+			idx->last = i + offs[k - 1] + 1;
+	}
+
+	idx->len = len;
+}
+
+size_t str_line_index_count(const str_line_index* const idx) {
+	STATS_CALL(str_line_index_count, 0);
+
+	return idx->num_breaks + (idx->len > idx->last);
+}
+
+str str_line_index_get(const str_line_index* const idx, const str s, const size_t n) {
+	STATS_CALL(str_line_index_get, 0);
+
+	if(n >= str_line_index_count(idx))
+		return str_null;
+
+	const char* const src = str_ptr(s);
+	const char* const end = src + idx->len;
+	const char* p = src + start_at(idx, n >> idx->shift);
+
+	// sampled index
+	for(size_t i = n & (((size_t)1 << idx->shift) - 1); i > 0; --i)
+		p = (const char*)memchr(p, '\n', end - p) + 1;
+
+	// end of the line
+	const char* q;
+
+	if(idx->shift == 0)
+		q = (n < idx->num_breaks) ? (src + start_at(idx, n + 1) - 1) : end;
+	else if(!(q = memchr(p, '\n', end - p)))
+		q = end;
+
+	return str_ref_mem(p, q - p);
+}
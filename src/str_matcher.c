@@ -0,0 +1,319 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// Multi-pattern search with the Aho-Corasick automaton, compiled into a DFA. Bytes that occur
+// in the patterns get a class each, and all other bytes share class 0, so each row of the
+// transition table is only as wide as the number of classes (rounded up to a power of 2).
+// The state 0 is the root of the automaton. Transitions to the states where a pattern ends are
+// flagged in the table, so the state properties are only looked up on a match.
+
+// no pattern
+#define NONE	UINT32_MAX
+
+// transition flag
+#define MATCH_FLAG	((uint32_t)1 << 31)
+
+struct str_matcher_state {
+	uint32_t depth;	// length of the longest prefix of a pattern represented by the state
+	uint32_t id;	// pattern ending in this state, or NONE
+	uint32_t link;	// nearest state on the failure path where a pattern ends, or 0
+};
+
+// transition
+static inline
+uint32_t next_state(const uint32_t* const delta, const uint8_t* const classes, const unsigned shift,
+					const uint32_t state, const char c) {
+	return delta[((size_t)state << shift) + classes[(uint8_t)c]];
+}
+
+// compiler
+void str_matcher_init(str_matcher* const m, const str* const patterns, const size_t count) {
+	STATS_CALL(str_matcher_init, calc_total_length(patterns, count));
+
+	memset(m, 0, sizeof(str_matcher));
+
+	// byte classes
+	size_t total = 0, nc = 1;
+
+	for(size_t k = 0; k < count; ++k) {
+		const char* const end = str_end(patterns[k]);
+
+		for(const char* p = str_ptr(patterns[k]); p < end; ++p)
+			if(m->classes[(uint8_t)*p] == 0)
+				m->classes[(uint8_t)*p] = nc++;
+
+		total += str_len(patterns[k]);
+	}
+
+	while(((size_t)1 << m->shift) < nc)
+		++m->shift;
+
+	const size_t width = (size_t)1 << m->shift;
+
+	// trie, where 0 in the transition table means no transition (the root is never a target)
+	uint32_t* delta = mem_alloc((total + 1) * width * sizeof(uint32_t));
+	struct str_matcher_state* states = mem_alloc((total + 1) * sizeof(struct str_matcher_state));
+	size_t n = 1;
+
+	memset(delta, 0, width * sizeof(uint32_t));
+	states[0] = (struct str_matcher_state){ 0, NONE, 0 };
+
+	for(size_t k = 0; k < count; ++k) {
+		const char* const end = str_end(patterns[k]);
+		uint32_t s = 0;
+
+		for(const char* p = str_ptr(patterns[k]); p < end; ++p) {
+			uint32_t* const t = &delta[((size_t)s << m->shift) + m->classes[(uint8_t)*p]];
+
+			if(*t == 0) {
+				memset(&delta[n * width], 0, width * sizeof(uint32_t));
+				states[n] = (struct str_matcher_state){ states[s].depth + 1, NONE, 0 };
+				*t = n++;
+			}
+
+			s = *t;
+		}
+
+		// empty patterns never match, and duplicates resolve to the first one
+		if(s != 0 && states[s].id == NONE)
+			states[s].id = k;
+
+		if(str_len(patterns[k]) > m->max_len)
+			m->max_len = str_len(patterns[k]);
+	}
+
+	// failure links in breadth-first order, turning the trie into a DFA
+	uint32_t* const queue = mem_alloc(n * sizeof(uint32_t));
+	uint32_t* const fail = mem_alloc(n * sizeof(uint32_t));
+	size_t head = 0, tail = 0;
+
+	for(size_t c = 0; c < width; ++c) {
+		const uint32_t t = delta[c];
+
+		if(t != 0) {
+			fail[t] = 0;
+			queue[tail++] = t;
+		}
+	}
+
+	while(head < tail) {
+		const uint32_t s = queue[head++];
+		const uint32_t f = fail[s];
+		uint32_t* const row = &delta[(size_t)s << m->shift];
+		const uint32_t* const frow = &delta[(size_t)f << m->shift];
+
+		states[s].link = (states[f].id != NONE) ? f : states[f].link;
+
+		for(size_t c = 0; c < width; ++c) {
+			if(row[c] != 0) {
+				fail[row[c]] = frow[c];
+				queue[tail++] = row[c];
+			} else
+				row[c] = frow[c];
+		}
+	}
+
+	mem_free(fail, n * sizeof(uint32_t));
+	mem_free(queue, n * sizeof(uint32_t));
+
+	// flags
+	for(size_t i = 0; i < n * width; ++i) {
+		const struct str_matcher_state* const t = &states[delta[i]];
+
+		if(t->id != NONE || t->link != 0)
+			delta[i] |= MATCH_FLAG;
+	}
+
+	// release the unused space
+	if(n < total + 1) {
+		delta = mem_realloc(delta, (total + 1) * width * sizeof(uint32_t), n * width * sizeof(uint32_t));
+		states = mem_realloc(states, (total + 1) * sizeof(struct str_matcher_state), n * sizeof(struct str_matcher_state));
+	}
+
+	m->delta = delta;
+	m->states = states;
+	m->num_states = n;
+
+	// bytes that can start a match, for skipping over the text in the root state
+	char start[256];
+	size_t ns = 0;
+
+	for(size_t c = 0; c < 256; ++c)
+		if(delta[m->classes[c]] != 0)
+			start[ns++] = (char)c;
+
+	bitset_init(&m->start, str_ref_mem(start, ns));
+}
+
+void str_matcher_free(str_matcher* const m) {
+	STATS_CALL(str_matcher_free, 0);
+
+	const size_t width = (size_t)1 << m->shift;
+
+	mem_free(m->delta, m->num_states * width * sizeof(uint32_t));
+	mem_free(m->states, m->num_states * sizeof(struct str_matcher_state));
+	memset(m, 0, sizeof(str_matcher));
+}
+
+// prefilter: in the root state the text is skipped up to the next byte that can start a match,
+// unless the skips turn out to be too short on average
+#define SKIP_MIN_CALLS		64
+#define SKIP_MIN_DISTANCE	8
+
+typedef struct {
+	size_t calls, skipped;
+} skip_stats;
+
+static inline
+const char* skip(const str_matcher* const m, const char* const p, const char* const end, skip_stats* const st) {
+	if(st->calls == SIZE_MAX)
+		return p;	// disabled
+
+	const char* const q = bitset_search(&m->start, p, end);
+
+	st->skipped += q - p;
+
+	if(++st->calls >= SKIP_MIN_CALLS && st->skipped / st->calls < SKIP_MIN_DISTANCE)
+		st->calls = SIZE_MAX;
+
+	return q;
+}
+
+// leftmost search
+bool str_matcher_find(const str_matcher* const m, const str s, const size_t pos,
+					  const str_match_kind kind, str_match* const match) {
+	STATS_CALL(str_matcher_find, str_len(s));
+
+	if(pos >= str_len(s) || m->num_states <= 1)
+		return false;
+
+	const char* const src = str_ptr(s);
+	const char* const end = str_end(s);
+	const struct str_matcher_state* const states = m->states;
+
+	const uint32_t* const delta = m->delta;
+	const uint8_t* const classes = m->classes;
+	const unsigned shift = m->shift;
+
+	// with single byte patterns any byte from the start set is a match
+	if(m->max_len == 1) {
+		const char* const p = bitset_search(&m->start, src + pos, end);
+
+		if(p == end)
+			return false;
+
+		*match = (str_match){ states[next_state(delta, classes, shift, 0, *p) & ~MATCH_FLAG].id, p - src, 1 };
+		return true;
+	}
+
+	skip_stats st = { 0, 0 };
+	size_t best = SIZE_MAX;	// start of the best match so far
+	uint32_t state = 0, id = NONE, len = 0;
+
+	for(const char* p = src + pos; p < end; ) {
+		if(state == 0) {
+			// no match starting at or before the best one is possible from the root state
+			if(best != SIZE_MAX || (p = skip(m, p, end, &st)) == end)
+				break;
+		}
+
+		const uint32_t t = next_state(delta, classes, shift, state, *p++);
+		const size_t i = p - src;	// end of the current position
+
+		state = t & ~MATCH_FLAG;
+
+		// same for any other state
+		if(best != SIZE_MAX && i - states[state].depth > best)
+			break;
+
+		if(!(t & MATCH_FLAG))
+			continue;
+
+		// the longest pattern ending here is the only candidate, as the others start later
+		const uint32_t k = (states[state].id != NONE) ? state : states[state].link;
+		const size_t start = i - states[k].depth;
+
+		if(start < best
+		|| (start == best && (kind == str_match_leftmost_first ? (states[k].id < id) : (states[k].depth > len)))) {
+			best = start;
+			id = states[k].id;
+			len = states[k].depth;
+		}
+	}
+
+	if(best == SIZE_MAX)
+		return false;
+
+	*match = (str_match){ id, best, len };
+	return true;
+}
+
+// overlapping search
+bool str_matcher_find_overlapping(const str_matcher* const m, const str s, str_match_iter* const it,
+								  str_match* const match) {
+	STATS_CALL(str_matcher_find_overlapping, str_len(s));
+
+	const char* const src = str_ptr(s);
+	const char* const end = str_end(s);
+	const struct str_matcher_state* const states = m->states;
+
+	skip_stats st = { 0, 0 };
+	const char* p = src + it->pos;
+
+	while(it->link == 0) {
+		if(p >= end)
+			return false;
+
+		if(it->state == 0 && (p = skip(m, p, end, &st)) == end) {
+			it->pos = str_len(s);
+			return false;
+		}
+
+		const uint32_t t = next_state(m->delta, m->classes, m->shift, it->state, *p++);
+
+		it->state = t & ~MATCH_FLAG;
+
+		if(t & MATCH_FLAG)
+			it->link = (states[it->state].id != NONE) ? it->state : states[it->state].link;
+	}
+
+	// report the pending matches ending at the current position, the longest first
+	const uint32_t t = it->link;
+
+	it->pos = p - src;
+	it->link = states[t].link;
+
+	*match = (str_match){ states[t].id, it->pos - states[t].depth, states[t].depth };
+	return true;
+}
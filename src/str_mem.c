@@ -34,7 +34,61 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdio.h>
 
+// allocators in effect (NULL for libc)
+const str_allocator* mem_process_allocator = NULL;
+_Thread_local const str_allocator* mem_thread_allocator = NULL;
+
+void str_set_allocator(const str_allocator* const a) {
+	STATS_CALL(str_set_allocator, 0);
+
+	mem_process_allocator = a;
+}
+
+void str_set_thread_allocator(const str_allocator* const a) {
+	STATS_CALL(str_set_thread_allocator, 0);
+
+	mem_thread_allocator = a;
+}
+
+const str_allocator* str_get_allocator(void) {
+	STATS_CALL(str_get_allocator, 0);
+
+	return mem_allocator();
+}
+
+// string deallocation
+void str_free_impl(const str s) {
+	if(str_is_shared(s))
+		mem_release_shared(s);
+	else if(str_is_acquired(s))
+		free((void*)s.ptr);
+	else
+		mem_free((void*)s.ptr, mem_size(s));
+}
+
+// growable strings
+char* mem_grow(str* const s, const size_t n) {
+	const size_t size = mem_size(*s);
+	const size_t cap = mem_capacity(n);
+	char* p = (char*)s->ptr;
+
+	// memory from malloc is moved to a block with the allocator header
+	if(str_is_acquired(*s)) {
+		p = memcpy(mem_alloc(cap), s->ptr, str_len(*s));
+		free((void*)s->ptr);
+	} else if(cap != size)
+		p = mem_realloc(p, size, cap);
+
+	*s = (str){ p, str_growable_prop(str_len(*s)) };
+	return p;
+}
+
 void mem_failure(void) {
+	const str_allocator* const a = mem_allocator();
+
+	if(a && a->failure)
+		a->failure(a->ctx);
+
 	perror("memory allocation failure");
 	exit(125);
 }
@@ -33,6 +33,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "str_impl.h"
 
 size_t str_partition_array(bool (*pred)(const str), str* const array, const size_t count) {
+	STATS_CALL(str_partition_array, 0);
+
 	if(!array)
 		return 0;
 
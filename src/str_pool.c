@@ -0,0 +1,231 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+#include <pthread.h>
+
+// size classes: 16, 32, 64, 128, and 256 bytes
+#define POOL_NUM_CLASSES	5
+#define POOL_MIN_BLOCK		((size_t)16)
+#define POOL_MAX_BLOCK		(POOL_MIN_BLOCK << (POOL_NUM_CLASSES - 1))
+
+// default maximum number of free blocks per size class
+#define POOL_DEFAULT_LIMIT	1024
+
+// each block is preceded by a header that holds either the size class index,
+// or the size of the block if it is too big for any class
+static inline
+size_t size_class(const size_t n) {
+	size_t c = 0;
+
+	while(c < POOL_NUM_CLASSES && n > (POOL_MIN_BLOCK << c))
+		++c;
+
+	return (c < POOL_NUM_CLASSES) ? c : n;
+}
+
+static inline
+size_t block_size(const size_t h) {
+	return (h < POOL_NUM_CLASSES) ? (POOL_MIN_BLOCK << h) : h;
+}
+
+// per-thread free lists
+typedef struct {
+	size_t* head[POOL_NUM_CLASSES];
+	size_t count[POOL_NUM_CLASSES];
+	size_t limit[POOL_NUM_CLASSES];
+	bool ready;
+} pool_state;
+
+static _Thread_local pool_state pool;
+
+// release all free blocks
+static
+void pool_release(pool_state* const ps) {
+	for(size_t c = 0; c < POOL_NUM_CLASSES; ++c) {
+		for(size_t* h = ps->head[c]; h; ) {
+			size_t* const next = *(size_t**)(h + 1);
+
+			free(h);
+			h = next;
+		}
+
+		ps->head[c] = NULL;
+		ps->count[c] = 0;
+	}
+}
+
+// thread exit handler; the key is already cleared at this point, so the state is reset
+// to register it again if any block is freed later on, e.g. from another destructor
+static pthread_key_t pool_key;
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+
+static
+void pool_thread_exit(void* ps) {
+	pool_release(ps);
+	((pool_state*)ps)->ready = false;
+}
+
+static
+void pool_make_key(void) { pthread_key_create(&pool_key, pool_thread_exit); }
+
+static
+pool_state* pool_get(void) {
+	if(!pool.ready) {
+		for(size_t c = 0; c < POOL_NUM_CLASSES; ++c)
+			pool.limit[c] = POOL_DEFAULT_LIMIT;
+
+		pthread_once(&pool_key_once, pool_make_key);
+		pthread_setspecific(pool_key, &pool);
+		pool.ready = true;
+	}
+
+	return &pool;
+}
+
+// allocator interface
+static
+void* pool_alloc(void* ctx, size_t n) {
+	(void)ctx;
+
+	const size_t c = size_class(n);
+	size_t* h;
+
+	if(c < POOL_NUM_CLASSES && (h = pool.head[c])) {
+		pool.head[c] = *(size_t**)(h + 1);
+		--pool.count[c];
+	} else {
+		if(n > SIZE_MAX - sizeof(size_t) || !(h = malloc(sizeof(size_t) + block_size(c))))
+			return NULL;
+
+		*h = c;
+	}
+
+	return h + 1;
+}
+
+static
+void pool_free(void* ctx, void* p) {
+	(void)ctx;
+
+	if(!p)
+		return;
+
+	size_t* const h = (size_t*)p - 1;
+	const size_t c = *h;
+
+	if(c < POOL_NUM_CLASSES) {
+		pool_state* const ps = pool_get();
+
+		if(ps->count[c] < ps->limit[c]) {
+			*(size_t**)p = ps->head[c];
+			ps->head[c] = h;
+			++ps->count[c];
+			return;
+		}
+	}
+
+	free(h);
+}
+
+static
+void* pool_realloc(void* ctx, void* p, size_t n) {
+	if(!p)
+		return pool_alloc(ctx, n);
+
+	size_t* const h = (size_t*)p - 1;
+	const size_t c = size_class(n);
+
+	// same size class
+	if(c == *h && c < POOL_NUM_CLASSES)
+		return p;
+
+	// both blocks are too big for the pool
+	if(*h >= POOL_NUM_CLASSES && c >= POOL_NUM_CLASSES) {
+		if(n > SIZE_MAX - sizeof(size_t))
+			return NULL;
+
+		size_t* const hh = realloc(h, sizeof(size_t) + n);
+
+		if(!hh)
+			return NULL;
+
+		*hh = n;
+		return hh + 1;
+	}
+
+	// move to the block of the new size class
+	const size_t size = block_size(*h);
+	void* const pp = pool_alloc(ctx, n);
+
+	if(pp) {
+		memcpy(pp, p, (n < size) ? n : size);
+		pool_free(ctx, p);
+	}
+
+	return pp;
+}
+
+const str_allocator str_pool_allocator = {
+	.alloc = pool_alloc,
+	.realloc = pool_realloc,
+	.free = pool_free
+};
+
+// pool control
+void str_pool_set_limit(const size_t block_size, const size_t max_free) {
+	STATS_CALL(str_pool_set_limit, 0);
+
+	const size_t c = size_class(block_size);
+
+	if(c < POOL_NUM_CLASSES) {
+		pool_state* const ps = pool_get();
+
+		ps->limit[c] = max_free;
+
+		// drop the excess
+		while(ps->count[c] > max_free) {
+			size_t* const h = ps->head[c];
+
+			ps->head[c] = *(size_t**)(h + 1);
+			--ps->count[c];
+			free(h);
+		}
+	}
+}
+
+void str_pool_trim(void) {
+	STATS_CALL(str_pool_trim, 0);
+
+	pool_release(&pool);
+}
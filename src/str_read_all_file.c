@@ -45,6 +45,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <errno.h>
 
 int str_read_all_file(str* const dest, const char* const file_name) {
+	STATS_CALL(str_read_all_file, 0);
+
 	// open the file
 	int fd, err;
 
@@ -92,7 +94,7 @@ int str_read_all_file(str* const dest, const char* const file_name) {
 		while((n = read(fd, p, end - p)) < 0) {
 			if((err = errno) != EINTR) {
 				close(fd);
-				free(buff);
+				mem_free(buff, info.st_size + 1);
 				return err;
 			}
 		}
@@ -100,18 +102,26 @@ int str_read_all_file(str* const dest, const char* const file_name) {
 
 	// close the file
 	if(close(fd) < 0) {
-		free(buff);
+		mem_free(buff, info.st_size + 1);
 		return errno;
 	}
 
+	// the file may have been truncated after fstat
+	if(p == buff) {
+		mem_free(buff, info.st_size + 1);
+		str_clear(dest);
+		return 0;
+	}
+
 	// null-terminate
 	*p = 0;
 
 	// realloc if we have read less bytes than expected
-	if(p > buff && p < end)
-		buff = mem_realloc(buff, p - buff + 1);
+	if(p < end)
+		buff = mem_realloc(buff, info.st_size + 1, p - buff + 1);
 
 	// assign result
-	str_assign(dest, str_acquire_mem(buff, p - buff));
+	str_assign(dest, mem_acquire(buff, p - buff));
+	STATS_OUTPUT(p - buff);
 	return 0;
 }
@@ -33,6 +33,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "str_impl.h"
 
 void str_repeat(str* const s, size_t n) {
+	STATS_CALL_STR(str_repeat, str_len(*s), s);
+
 	const size_t len = str_len(*s);
 
 	if(len == 0 || n == 1)
@@ -50,5 +52,5 @@ void str_repeat(str* const s, size_t n) {
 		p = mem_append(p, s->ptr, len);
 
 	*p = 0;
-	str_assign(s, str_acquire_mem(buff, p - buff));
+	str_assign(s, mem_acquire(buff, p - buff));
 }
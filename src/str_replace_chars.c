@@ -32,41 +32,52 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "str_impl.h"
 
-size_t str_replace_chars(str* const dest, const str charset, const str repl) {
-	// charset
-	if(str_is_empty(*dest) || str_is_empty(charset))
-		return 0;	// nothing to do
-
-	// bitset
-	uint8_t bitset[BITSET_BUFF_SIZE];
-
-	bitset_init(bitset, charset);
-
-	// replacement
+// replacement
+static
+size_t replace(str* const dest, const str_charset* const cs, const str repl) {
 	size_t nrep = 0;
-	str_builder sb;
-
-	sb_init(&sb);
+	str_builder sb = str_builder_null;
 
 	const char* const end = str_end(*dest);
 	const char* s = str_ptr(*dest);
 
-	for(const char* p = bitset_search(bitset, s, end);
+	for(const char* p = bitset_search(cs, s, end);
 		p < end;
-		p = bitset_search(bitset, s, end)
+		p = bitset_search(cs, s, end)
 	) {
-		sb_append_mem(&sb, s, p - s);
-		sb_append(&sb, repl);
+		str_builder_append_mem(&sb, s, p - s);
+		str_builder_append_str(&sb, repl);
 
 		++nrep;
 
 		s = p + 1;
 	}
 
-	sb_append_mem(&sb, s, end - s);
-
-	if(nrep > 0)
-		assign_sb(dest, &sb);
+	if(nrep > 0) {
+		str_builder_append_mem(&sb, s, end - s);
+		str_builder_finish(dest, &sb);
+	}
 
 	return nrep;
 }
+
+size_t str_replace_chars(str* const dest, const str charset, const str repl) {
+	STATS_CALL_STR(str_replace_chars, str_len(*dest), dest);
+
+	// charset
+	if(str_is_empty(*dest) || str_is_empty(charset))
+		return 0;	// nothing to do
+
+	// bitset
+	str_charset cs;
+
+	bitset_init(&cs, charset);
+
+	return replace(dest, &cs, repl);
+}
+
+size_t str_replace_chars_cs(str* const dest, const str_charset* const cs, const str repl) {
+	STATS_CALL_STR(str_replace_chars_cs, str_len(*dest), dest);
+
+	return replace(dest, cs, repl);
+}
@@ -0,0 +1,123 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// replacement table
+void str_replace_table_init(str_replace_table* const t, const str_replace_pair* const pairs, const size_t count) {
+	STATS_CALL(str_replace_table_init, count);
+
+	// the replacements are copied into one block, after the array of references to them
+	size_t n = 0;
+
+	for(size_t i = 0; i < count; ++i)
+		n += str_len(pairs[i].repl);
+
+	str* const repl = (count > 0) ? mem_alloc(count * sizeof(str) + n) : NULL;
+
+	// the array is borrowed for the patterns first
+	for(size_t i = 0; i < count; ++i)
+		repl[i] = str_ref(pairs[i].patt);
+
+	str_matcher_init(&t->matcher, repl, count);
+
+	char* p = (char*)(repl + count);
+
+	for(size_t i = 0; i < count; ++i) {
+		repl[i] = str_ref_mem(p, str_len(pairs[i].repl));
+		p = append_str(p, pairs[i].repl);
+	}
+
+	t->repl = repl;
+	t->count = count;
+	t->size = count * sizeof(str) + n;
+}
+
+void str_replace_table_free(str_replace_table* const t) {
+	STATS_CALL(str_replace_table_free, 0);
+
+	str_matcher_free(&t->matcher);
+	mem_free((void*)t->repl, t->size);
+	memset(t, 0, sizeof(str_replace_table));
+}
+
+// matches found on the first pass; if there are more, the rest are found again on the second pass
+#define MAX_MATCHES	64
+
+size_t str_replace_map(str* const dest, const str_replace_table* const t) {
+	STATS_CALL_STR(str_replace_map, str_len(*dest), dest);
+
+	const str s = *dest;
+	str_match matches[MAX_MATCHES];
+	size_t nrep = 0, n = str_len(s), pos = 0;
+	str_match m;
+
+	// count matches and the result size
+	while(str_matcher_find(&t->matcher, s, pos, str_match_leftmost_first, &m)) {
+		if(nrep < MAX_MATCHES)
+			matches[nrep] = m;
+
+		n = n - m.len + str_len(t->repl[m.id]);
+		pos = m.pos + m.len;
+		++nrep;
+	}
+
+	if(nrep == 0)
+		return 0;
+
+	if(n == 0) {
+		str_clear(dest);
+		return nrep;
+	}
+
+	// replacement
+	char* const buff = mem_alloc(n + 1);
+	char* p = buff;
+
+	pos = 0;
+
+	for(size_t i = 0; i < nrep; ++i) {
+		if(i < MAX_MATCHES)
+			m = matches[i];
+		else
+			str_matcher_find(&t->matcher, s, pos, str_match_leftmost_first, &m);
+
+		p = append_str(mem_append(p, str_ptr(s) + pos, m.pos - pos), t->repl[m.id]);
+		pos = m.pos + m.len;
+	}
+
+	p = mem_append(p, str_ptr(s) + pos, str_len(s) - pos);
+	*p = 0;
+
+	str_assign(dest, mem_acquire(buff, n));
+	return nrep;
+}
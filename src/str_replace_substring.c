@@ -30,43 +30,79 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-#define _GNU_SOURCE
-
 #include "str_impl.h"
 
 size_t str_replace_substring(str* const dest, const str patt, const str repl) {
+	STATS_CALL_STR(str_replace_substring, str_len(*dest), dest);
+
 	// initial checks
 	if(str_is_empty(*dest) || str_is_empty(patt))
 		return 0;	// nothing to do
 
-	// replacement
-	size_t nrep = 0;
-	str_builder sb;
-
-	sb_init(&sb);
-
-	const char* const ss = str_ptr(patt);
 	const size_t sslen = str_len(patt);
 
+	const char* const src = str_ptr(*dest);
 	const char* const end = str_end(*dest);
-	const char* s = str_ptr(*dest);
 
-	for(const char* p = memmem(s, end - s, ss, sslen);
-		p;
-		p = memmem(s, end - s, ss, sslen)
-	) {
-		sb_append_mem(&sb, s, p - s);
-		sb_append(&sb, repl);
+	str_finder f;
+
+	str_finder_init(&f, patt);
+
+	// count matches
+	size_t nrep = 0;
 
+	for(size_t i = str_finder_first(&f, *dest); i < str_len(*dest); i = str_finder_next(&f, *dest, i + sslen))
 		++nrep;
 
-		s = p + sslen;
+	if(nrep == 0)
+		return 0;
+
+	// result size
+	const char* const rs = str_ptr(repl);
+	const size_t rslen = str_len(repl);
+	const size_t len = str_len(*dest);
+	const size_t n = len - nrep * sslen + nrep * rslen;
+
+	if(n == 0) {
+		str_clear(dest);
+		return nrep;
 	}
 
-	sb_append_mem(&sb, s, end - s);
+	// the result is written over the source if it is not longer than the source, the source is
+	// an exclusively owned string (plain or growable), and neither the pattern nor the replacement
+	// point into it; a growable string stays growable, with its capacity derived from the new length
+	const bool in_place = rslen <= sslen
+					   && str_is_owner(*dest)
+					   && !str_is_shared(*dest)
+					   && !mem_overlaps(*dest, patt)
+					   && !mem_overlaps(*dest, repl);
+
+	char* const buff = in_place ? (char*)src : mem_alloc(n + 1);
+	char* p = buff;
+	const char* s = src;
+
+	// replacement (memmove, because in-place the pieces may overlap)
+	for(size_t i = 0; i < nrep; ++i) {
+		const char* const m = src + str_finder_next(&f, *dest, s - src);
+
+		memmove(p, s, m - s);
+		p = mem_append(p + (m - s), rs, rslen);
+		s = m + sslen;
+	}
+
+	memmove(p, s, end - s);
+	buff[n] = 0;
+
+	if(in_place) {
+		// the tail of the buffer is not reclaimed, but it is no longer accounted for
+		const str res = { buff, (dest->prop & 7) | str_ref_prop(n) };
+
+		if(!str_is_acquired(*dest))
+			STATS_FREE(mem_header_of((void*)dest->ptr)->owner, mem_size(*dest) - mem_size(res));
 
-	if(nrep > 0)
-		assign_sb(dest, &sb);
+		*dest = res;
+	} else
+		str_assign(dest, mem_acquire(buff, n));
 
 	return nrep;
 }
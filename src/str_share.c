@@ -0,0 +1,85 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+#include <stdatomic.h>
+
+// shared string header, immediately followed by the string itself; the whole block comes from
+// mem_alloc, so it also records its allocator, and the last owner can release it from any thread
+typedef struct {
+	atomic_size_t refs;
+} share_header;
+
+_Static_assert(sizeof(share_header) == SHARE_HEADER_SIZE, "unexpected shared string header size");
+
+static inline
+share_header* header_of(const str s) {
+	return (share_header*)s.ptr - 1;
+}
+
+void str_share(str* const dest, const str s) {
+	STATS_CALL_STR(str_share, str_len(s), dest);
+
+	// already shared
+	if(str_is_shared(s)) {
+		atomic_fetch_add_explicit(&header_of(s)->refs, 1, memory_order_relaxed);
+		str_assign(dest, s);
+		return;
+	}
+
+	// make a shared copy
+	const size_t n = str_len(s);
+
+	if(n == 0) {
+		str_clear(dest);
+		return;
+	}
+
+	share_header* const h = mem_alloc(sizeof(share_header) + n + 1);
+
+	atomic_init(&h->refs, 1);
+
+	char* const p = memcpy(h + 1, s.ptr, n);
+
+	p[n] = 0;
+	str_assign(dest, (str){ p, str_shared_prop(n) });
+}
+
+void mem_release_shared(const str s) {
+	share_header* const h = header_of(s);
+
+	if(atomic_fetch_sub_explicit(&h->refs, 1, memory_order_release) == 1) {
+		atomic_thread_fence(memory_order_acquire);
+		mem_free(h, mem_size(s));
+	}
+}
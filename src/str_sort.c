@@ -33,9 +33,25 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "str_impl.h"
 
 int str_order_asc(const void* const s1, const void* const s2) {
+	STATS_CALL(str_order_asc, 0);
+
 	return str_cmp(*(const str*)s1, *(const str*)s2);
 }
 
 int str_order_desc(const void* const s1, const void* const s2) {
+	STATS_CALL(str_order_desc, 0);
+
 	return -str_order_asc(s1, s2);
 }
+
+int str_sso_order_asc(const void* const s1, const void* const s2) {
+	STATS_CALL(str_sso_order_asc, 0);
+
+	return str_sso_cmp((const str_sso*)s1, (const str_sso*)s2);
+}
+
+int str_sso_order_desc(const void* const s1, const void* const s2) {
+	STATS_CALL(str_sso_order_desc, 0);
+
+	return -str_sso_order_asc(s1, s2);
+}
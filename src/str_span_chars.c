@@ -33,16 +33,24 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "str_impl.h"
 
 size_t str_span_chars(const str s, const str charset) {
+	STATS_CALL(str_span_chars, str_len(s));
+
 	// https://man7.org/linux/man-pages/man3/strspn.3.html
 	// https://git.musl-libc.org/cgit/musl/tree/src/string/strspn.c
 	if(str_is_empty(s) || str_is_empty(charset))
 		return 0;
 
 	// build bitset
-	uint8_t bitset[BITSET_BUFF_SIZE];
+	str_charset cs;
 
-	bitset_init(bitset, charset);
+	bitset_init(&cs, charset);
 
 	// search
-	return bitset_span(bitset, s.ptr, str_end(s)) - s.ptr;
+	return bitset_span(&cs, s.ptr, str_end(s)) - s.ptr;
+}
+
+size_t str_span_chars_cs(const str s, const str_charset* const cs) {
+	STATS_CALL(str_span_chars_cs, str_len(s));
+
+	return bitset_span(cs, str_ptr(s), str_end(s)) - str_ptr(s);
 }
@@ -33,6 +33,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "str_impl.h"
 
 size_t str_span_nonmatching_chars(const str s, const str charset) {
+	STATS_CALL(str_span_nonmatching_chars, str_len(s));
+
 	// https://man7.org/linux/man-pages/man3/strspn.3.html
 	// https://git.musl-libc.org/cgit/musl/tree/src/string/strcspn.c
 	if(str_is_empty(s))
@@ -42,10 +44,16 @@ size_t str_span_nonmatching_chars(const str s, const str charset) {
 		return str_len(s);
 
 	// build bitset
-	uint8_t bitset[BITSET_BUFF_SIZE];
+	str_charset cs;
 
-	bitset_init(bitset, charset);
+	bitset_init(&cs, charset);
 
 	// search
-	return bitset_search(bitset, s.ptr, str_end(s)) - s.ptr;
+	return bitset_search(&cs, s.ptr, str_end(s)) - s.ptr;
+}
+
+size_t str_span_nonmatching_chars_cs(const str s, const str_charset* const cs) {
+	STATS_CALL(str_span_nonmatching_chars_cs, str_len(s));
+
+	return bitset_search(cs, str_ptr(s), str_end(s)) - str_ptr(s);
 }
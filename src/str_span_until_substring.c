@@ -30,20 +30,14 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
-#define _GNU_SOURCE
-
 #include "str_impl.h"
 
 size_t str_span_until_substring(const str s, const str substr) {
-	size_t n = str_len(s);
+	STATS_CALL(str_span_until_substring, str_len(s));
 
-	if(n > 0) {
-		const char* const src = str_ptr(s);
-		const char* const p = memmem(src, n, str_ptr(substr), str_len(substr));
+	str_finder f;
 
-		if(p)
-			n = p - src;
-	}
+	str_finder_init(&f, substr);
 
-	return n;
+	return str_finder_first(&f, s);
 }
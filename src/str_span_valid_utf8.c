@@ -0,0 +1,316 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// UTF-8 validation. The input is validated in blocks of 64 bytes with the lookup algorithm from
+// J. Keiser, D. Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte"
+// (https://arxiv.org/abs/2010.03090), with all-ASCII blocks skipped after a single test. The vector
+// code reports the first byte where an error is detected, which may be up to 3 bytes past the start
+// of the invalid sequence, so the exact offset of the error is found by the scalar code, starting
+// from the last sequence boundary before that byte. The scalar code also validates the remaining
+// bytes after the last full block.
+
+// scalar version, returning the offset of the first invalid sequence, or `len`
+static
+size_t validate_scalar(const char* const s, size_t i, const size_t len) {
+	while(i < len) {
+		// ASCII, 8 bytes per step
+		uint64_t w;
+
+		if(len - i >= 8 && (memcpy(&w, s + i, 8), (w & 0x8080808080808080ull) == 0)) {
+			i += 8;
+			continue;
+		}
+
+		const str_decode_result r = str_decode_utf8(s + i, len - i);
+
+		if(r.status != STR_UTF8_OK)
+			break;
+
+		i += r.num_bytes;
+	}
+
+	return i;
+}
+
+// the start of the sequence that the validation has to be resumed from, given that all the
+// sequences ending before position `i` are valid
+static inline
+size_t boundary(const char* const s, const size_t i) {
+	size_t b = (i > 3) ? (i - 3) : 0;
+
+	while(b < i && ((uint8_t)s[b] & 0xC0) == 0x80)
+		++b;
+
+	return b;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+// error classes
+#define TOO_SHORT		(1 << 0)
+#define TOO_LONG		(1 << 1)
+#define OVERLONG_3		(1 << 2)
+#define TOO_LARGE		(1 << 3)
+#define SURROGATE		(1 << 4)
+#define OVERLONG_2		(1 << 5)
+#define TOO_LARGE_1000	(1 << 6)
+#define OVERLONG_4		(1 << 6)
+#define TWO_CONTS		(1 << 7)
+#define CARRY			(TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+// lookup tables, indexed by the high nibble of the previous byte, the low nibble of the previous
+// byte, and the high nibble of the current byte
+#define BYTE_1_HIGH	\
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,	\
+	TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,	\
+	TOO_SHORT | OVERLONG_2,	\
+	TOO_SHORT,	\
+	TOO_SHORT | OVERLONG_3 | SURROGATE,	\
+	TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+
+#define BYTE_1_LOW	\
+	CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,	\
+	CARRY | OVERLONG_2,	\
+	CARRY,	\
+	CARRY,	\
+	CARRY | TOO_LARGE,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	\
+	CARRY | TOO_LARGE | TOO_LARGE_1000
+
+#define BYTE_2_HIGH	\
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,	\
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,	\
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,	\
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,	\
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,	\
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+
+// the last bytes of a block that start a sequence not complete within the block
+#define INCOMPLETE	\
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+
+// SSSE3 version
+typedef struct {
+	__m128i prev, incomplete;
+} state_ssse3;
+
+// returns the vector of error flags for the bytes of `v`
+__attribute__((target("ssse3"), always_inline))
+static inline
+__m128i check_ssse3(state_ssse3* const st, const __m128i v) {
+	const __m128i mask4 = _mm_set1_epi8(0x0F);
+	const __m128i prev1 = _mm_alignr_epi8(v, st->prev, 16 - 1);
+	const __m128i prev2 = _mm_alignr_epi8(v, st->prev, 16 - 2);
+	const __m128i prev3 = _mm_alignr_epi8(v, st->prev, 16 - 3);
+
+	// special cases of two-byte combinations
+	const __m128i b1h = _mm_shuffle_epi8(_mm_setr_epi8(BYTE_1_HIGH), _mm_and_si128(_mm_srli_epi16(prev1, 4), mask4));
+	const __m128i b1l = _mm_shuffle_epi8(_mm_setr_epi8(BYTE_1_LOW), _mm_and_si128(prev1, mask4));
+	const __m128i b2h = _mm_shuffle_epi8(_mm_setr_epi8(BYTE_2_HIGH), _mm_and_si128(_mm_srli_epi16(v, 4), mask4));
+	const __m128i sc = _mm_and_si128(_mm_and_si128(b1h, b1l), b2h);
+
+	// third and fourth bytes of 3- and 4-byte sequences must be continuations
+	const __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80))),
+										_mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80))));
+
+	st->incomplete = _mm_subs_epu8(v, _mm_setr_epi8(INCOMPLETE));
+	st->prev = v;
+
+	return _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8((char)0x80)), sc);
+}
+
+// mask of the bytes with errors
+__attribute__((target("ssse3"), always_inline))
+static inline
+uint64_t error_mask_ssse3(const __m128i e) {
+	return (uint16_t)~_mm_movemask_epi8(_mm_cmpeq_epi8(e, _mm_setzero_si128()));
+}
+
+// returns the offset of the first byte where an error is detected, or the offset of the
+// remaining tail shorter than 64 bytes
+__attribute__((target("ssse3")))
+static
+size_t validate_ssse3(const char* const s, const size_t len) {
+	state_ssse3 st = { _mm_setzero_si128(), _mm_setzero_si128() };
+	size_t i = 0;
+
+	for(; len - i >= 64; i += 64) {
+		const __m128i v0 = _mm_loadu_si128((const __m128i*)(s + i));
+		const __m128i v1 = _mm_loadu_si128((const __m128i*)(s + i + 16));
+		const __m128i v2 = _mm_loadu_si128((const __m128i*)(s + i + 32));
+		const __m128i v3 = _mm_loadu_si128((const __m128i*)(s + i + 48));
+
+		if(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3))) == 0) {
+			// ASCII block
+			if(error_mask_ssse3(st.incomplete) != 0)
+				break;
+
+			st.incomplete = _mm_setzero_si128();
+			st.prev = v3;
+		} else {
+			const uint64_t m = error_mask_ssse3(check_ssse3(&st, v0))
+							 | (error_mask_ssse3(check_ssse3(&st, v1)) << 16)
+							 | (error_mask_ssse3(check_ssse3(&st, v2)) << 32)
+							 | (error_mask_ssse3(check_ssse3(&st, v3)) << 48);
+
+			if(m != 0)
+				return i + __builtin_ctzll(m);
+		}
+	}
+
+	return i;
+}
+
+// AVX2 version
+typedef struct {
+	__m256i prev, incomplete;
+} state_avx2;
+
+// bytes of `v` shifted right by `n`, with the last bytes of `prev` shifted in
+#define PREV_AVX2(v, prev, n)	\
+	_mm256_alignr_epi8((v), _mm256_permute2x128_si256((prev), (v), 0x21), 16 - (n))
+
+// returns the vector of error flags for the bytes of `v`
+__attribute__((target("avx2"), always_inline))
+static inline
+__m256i check_avx2(state_avx2* const st, const __m256i v) {
+	const __m256i mask4 = _mm256_set1_epi8(0x0F);
+	const __m256i prev1 = PREV_AVX2(v, st->prev, 1);
+	const __m256i prev2 = PREV_AVX2(v, st->prev, 2);
+	const __m256i prev3 = PREV_AVX2(v, st->prev, 3);
+
+	// special cases of two-byte combinations
+	const __m256i b1h = _mm256_shuffle_epi8(_mm256_setr_epi8(BYTE_1_HIGH, BYTE_1_HIGH),
+											_mm256_and_si256(_mm256_srli_epi16(prev1, 4), mask4));
+	const __m256i b1l = _mm256_shuffle_epi8(_mm256_setr_epi8(BYTE_1_LOW, BYTE_1_LOW),
+											_mm256_and_si256(prev1, mask4));
+	const __m256i b2h = _mm256_shuffle_epi8(_mm256_setr_epi8(BYTE_2_HIGH, BYTE_2_HIGH),
+											_mm256_and_si256(_mm256_srli_epi16(v, 4), mask4));
+	const __m256i sc = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+
+	// third and fourth bytes of 3- and 4-byte sequences must be continuations
+	const __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80))),
+										   _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80))));
+
+	st->incomplete = _mm256_subs_epu8(v, _mm256_setr_epi8(255, 255, 255, 255, 255, 255, 255, 255,
+														  255, 255, 255, 255, 255, 255, 255, 255, INCOMPLETE));
+	st->prev = v;
+
+	return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8((char)0x80)), sc);
+}
+
+// mask of the bytes with errors
+__attribute__((target("avx2"), always_inline))
+static inline
+uint64_t error_mask_avx2(const __m256i e) {
+	return (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(e, _mm256_setzero_si256()));
+}
+
+// returns the offset of the first byte where an error is detected, or the offset of the
+// remaining tail shorter than 64 bytes
+__attribute__((target("avx2")))
+static
+size_t validate_avx2(const char* const s, const size_t len) {
+	state_avx2 st = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+	size_t i = 0;
+
+	for(; len - i >= 64; i += 64) {
+		const __m256i v0 = _mm256_loadu_si256((const __m256i*)(s + i));
+		const __m256i v1 = _mm256_loadu_si256((const __m256i*)(s + i + 32));
+
+		if(_mm256_movemask_epi8(_mm256_or_si256(v0, v1)) == 0) {
+			// ASCII block
+			if(!_mm256_testz_si256(st.incomplete, st.incomplete))
+				break;
+
+			st.incomplete = _mm256_setzero_si256();
+			st.prev = v1;
+		} else {
+			const __m256i e0 = check_avx2(&st, v0);
+			const __m256i e1 = check_avx2(&st, v1);
+			const __m256i e = _mm256_or_si256(e0, e1);
+
+			if(!_mm256_testz_si256(e, e))
+				return i + __builtin_ctzll(error_mask_avx2(e0) | (error_mask_avx2(e1) << 32));
+		}
+	}
+
+	return i;
+}
+
+// implementation selection
+static size_t (*validate_impl)(const char* const, const size_t) = NULL;
+
+__attribute__((constructor))
+static
+void select_validate_impl(void) {
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx2"))
+		validate_impl = validate_avx2;
+	else if(__builtin_cpu_supports("ssse3"))
+		validate_impl = validate_ssse3;
+}
+
+#else	// no SIMD
+
+static size_t (*const validate_impl)(const char* const, const size_t) = NULL;
+
+#endif
+
+size_t utf8_span_valid(const char* const s, const size_t len) {
+	size_t i = 0;
+
+	if(validate_impl && len >= 64)
+		i = boundary(s, validate_impl(s, len));
+
+	return validate_scalar(s, i, len);
+}
+
+size_t str_span_valid_utf8(const str s) {
+	STATS_CALL(str_span_valid_utf8, str_len(s));
+
+	return utf8_span_valid(str_ptr(s), str_len(s));
+}
@@ -0,0 +1,119 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// iterator initialisation
+void str_split_init(str_split_iter* const it, const str s, const str charset, const bool skip_empty) {
+	STATS_CALL(str_split_init, str_len(charset));
+
+	it->ptr = str_ptr(s);
+	it->end = str_end(s);
+	it->substring = false;
+	it->skip_empty = skip_empty;
+
+	bitset_init(&it->cs, charset);
+}
+
+void str_split_init_substring(str_split_iter* const it, const str s, const str delim, const bool skip_empty) {
+	STATS_CALL(str_split_init_substring, str_len(delim));
+
+	it->ptr = str_ptr(s);
+	it->end = str_end(s);
+	it->substring = true;
+	it->skip_empty = skip_empty;
+
+	str_finder_init(&it->finder, delim);
+}
+
+// next field
+bool str_split_next(str_split_iter* const it, str* const field) {
+	STATS_CALL(str_split_next, 0);
+
+	const char* const end = it->end;
+
+	while(it->ptr) {
+		// runs of delimiter bytes are skipped in one go
+		if(it->skip_empty && !it->substring && (it->ptr = bitset_span(&it->cs, it->ptr, end)) == end)
+			break;
+
+		const char* const p = it->ptr;
+		const char* d;
+		size_t n;	// delimiter length
+
+		if(it->substring) {
+			n = str_len(it->finder.needle);
+			d = (n > 0) ? (p + str_finder_first(&it->finder, str_ref_mem(p, end - p))) : end;
+		} else {
+			n = 1;
+			d = bitset_search(&it->cs, p, end);
+		}
+
+		it->ptr = (d < end) ? (d + n) : NULL;
+
+		if(d > p || !it->skip_empty) {
+			*field = str_ref_mem(p, d - p);
+			return true;
+		}
+	}
+
+	it->ptr = NULL;
+	return false;
+}
+
+// split to array
+size_t str_split_array(const str_split_iter* const it, str* const array, const size_t n) {
+	STATS_CALL(str_split_array, it->ptr ? (size_t)(it->end - it->ptr) : 0);
+
+	if(!it->ptr)
+		return 0;
+
+	// without empty fields skipped, the number of fields is the number of delimiters plus one
+	if(n == 0 && !it->skip_empty) {
+		const str s = str_ref_mem(it->ptr, it->end - it->ptr);
+
+		return 1 + (it->substring ? str_finder_find_all(&it->finder, s, NULL, 0)
+								  : bitset_find_all(&it->cs, str_ptr(s), str_len(s), NULL, 0));
+	}
+
+	str_split_iter tmp = *it;
+	size_t count = 0;
+	str field;
+
+	for(; count < n && str_split_next(&tmp, &field); ++count)
+		array[count] = field;
+
+	while(str_split_next(&tmp, &field))
+		++count;
+
+	return count;
+}
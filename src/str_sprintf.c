@@ -32,22 +32,19 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "str_impl.h"
 
-#include <stdio.h>
-#include <stdarg.h>
-
 #define SMALL_BUFF_SIZE	256
 
-bool str_sprintf(str* const dest, const char* const fmt, ...) {
-	va_list ap;
+bool sprintf_impl(str* const dest, const char* const fmt, va_list ap) {
+	va_list ap2;
 
 	// try small buffer first
 	char small_buff[SMALL_BUFF_SIZE];
 
-	va_start(ap, fmt);
+	va_copy(ap2, ap);
 
-	const int n = vsnprintf(small_buff, SMALL_BUFF_SIZE, fmt, ap);
+	const int n = vsnprintf(small_buff, SMALL_BUFF_SIZE, fmt, ap2);
 
-	va_end(ap);
+	va_end(ap2);
 
 	if(n < 0)
 		return false;
@@ -65,9 +62,19 @@ bool str_sprintf(str* const dest, const char* const fmt, ...) {
 	// allocate and use a big buffer
 	char* const big_buff = mem_alloc(n + 1);
 
+	str_assign(dest, mem_acquire(big_buff, vsnprintf(big_buff, n + 1, fmt, ap)));
+	return true;
+}
+
+bool str_sprintf(str* const dest, const char* const fmt, ...) {
+	STATS_CALL_STR(str_sprintf, 0, dest);
+
+	va_list ap;
+
 	va_start(ap, fmt);
-	str_assign(dest, str_acquire_mem(big_buff, vsnprintf(big_buff, n + 1, fmt, ap)));
-	va_end(ap);
 
-	return true;
+	const bool ok = sprintf_impl(dest, fmt, ap);
+
+	va_end(ap);
+	return ok;
 }
@@ -0,0 +1,244 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+#ifdef STR_STATS
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+
+// per-thread counters
+_Thread_local str_stats stats_local;
+_Thread_local str_stats_id stats_current;
+
+// process-wide live memory
+static atomic_int_least64_t live_bytes, peak_bytes;
+
+// function names
+static const char* const names[STR_STATS_COUNT] = {
+	[str_stats_other] = "(other)",
+#define STATS_NAME(fn)	[str_stats_##fn] = #fn,
+	STR_STATS_FUNCTIONS(STATS_NAME)
+#undef STATS_NAME
+};
+
+static const char* const category_names[STR_STATS_CAT_COUNT] = {
+#define STATS_CATEGORY_NAME(cat)	[str_stats_cat_##cat] = #cat,
+	STR_STATS_CATEGORIES(STATS_CATEGORY_NAME)
+#undef STATS_CATEGORY_NAME
+};
+
+// allocation category of a function
+static
+str_stats_category category_of(const str_stats_id id) {
+	switch(id) {
+	case str_stats_str_clone:
+	case str_stats_str_share:
+	case str_stats_str_arena_clone:
+	case str_stats_str_sso_clone:
+		return str_stats_cat_clone;
+
+	case str_stats_str_concat_array:
+	case str_stats_str_arena_concat_array:
+		return str_stats_cat_concat;
+
+	case str_stats_str_join_array:
+	case str_stats_str_arena_join_array:
+		return str_stats_cat_join;
+
+	case str_stats_str_repeat:
+		return str_stats_cat_repeat;
+
+	case str_stats_str_sprintf:
+	case str_stats_str_arena_sprintf:
+		return str_stats_cat_sprintf;
+
+	case str_stats_str_read_all_file:
+		return str_stats_cat_read_all_file;
+
+	case str_stats_str_get_line:
+		return str_stats_cat_get_line;
+
+	case str_stats_str_replace_substring:
+	case str_stats_str_replace_map:
+	case str_stats_str_replace_chars:
+	case str_stats_str_replace_chars_cs:
+	case str_stats_str_replace_char_spans:
+	case str_stats_str_replace_char_spans_cs:
+	case str_stats_str_arena_replace_substring:
+	case str_stats_str_arena_replace_chars:
+	case str_stats_str_arena_replace_char_spans:
+	case str_stats_str_to_valid_utf8:
+		return str_stats_cat_replace;
+
+	default:
+		return str_stats_cat_other;
+	}
+}
+
+// memory tracking
+static
+void record_size(const size_t n) {
+	str_stats_sizes* const s = &stats_local.sizes[category_of(stats_current)];
+
+	++s->hist[(n > 1) ? (63 - __builtin_clzll(n)) : 0];
+
+	if(n > s->max_request)
+		s->max_request = n;
+}
+
+// arena allocations come from chunks that are already accounted for
+static inline
+bool is_heap(const str_allocator* const a) {
+	return !a || a->alloc != arena_alloc;
+}
+
+void stats_live(const int64_t delta) {
+	const int64_t live = atomic_fetch_add_explicit(&live_bytes, delta, memory_order_relaxed) + delta;
+	int64_t peak = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+
+	while(live > peak
+		  && !atomic_compare_exchange_weak_explicit(&peak_bytes, &peak, live,
+													memory_order_relaxed, memory_order_relaxed));
+}
+
+void stats_alloc(const str_allocator* const a, const size_t n) {
+	str_stats_counters* const c = &stats_local.fn[stats_current];
+
+	++c->allocs;
+	c->bytes_allocated += n;
+	record_size(n);
+
+	if(is_heap(a))
+		stats_live(n);
+}
+
+void stats_realloc(const str_allocator* const a, const size_t old_size, const size_t n) {
+	str_stats_counters* const c = &stats_local.fn[stats_current];
+
+	++c->reallocs;
+	c->bytes_allocated += n;
+	record_size(n);
+
+	if(is_heap(a))
+		stats_live((int64_t)n - (int64_t)old_size);
+}
+
+void stats_free(const str_allocator* const a, const size_t n) {
+	if(is_heap(a))
+		stats_live(-(int64_t)n);
+}
+
+int64_t str_stats_live_bytes(void) {
+	return atomic_load_explicit(&live_bytes, memory_order_relaxed);
+}
+
+int64_t str_stats_peak_bytes(void) {
+	return atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+}
+
+void str_stats_reset_peak(void) {
+	atomic_store_explicit(&peak_bytes, str_stats_live_bytes(), memory_order_relaxed);
+}
+
+void str_stats_snapshot(str_stats* const dest) {
+	*dest = stats_local;
+}
+
+void str_stats_merge(str_stats* const dest, const str_stats* const src) {
+	for(size_t i = 0; i < STR_STATS_COUNT; ++i) {
+		str_stats_counters* const d = &dest->fn[i];
+		const str_stats_counters* const s = &src->fn[i];
+
+		d->calls += s->calls;
+		d->bytes_in += s->bytes_in;
+		d->bytes_out += s->bytes_out;
+		d->allocs += s->allocs;
+		d->reallocs += s->reallocs;
+		d->bytes_allocated += s->bytes_allocated;
+	}
+
+	for(size_t i = 0; i < STR_STATS_CAT_COUNT; ++i) {
+		str_stats_sizes* const d = &dest->sizes[i];
+		const str_stats_sizes* const s = &src->sizes[i];
+
+		for(size_t j = 0; j < STR_STATS_BUCKETS; ++j)
+			d->hist[j] += s->hist[j];
+
+		if(s->max_request > d->max_request)
+			d->max_request = s->max_request;
+	}
+}
+
+void str_stats_reset(void) {
+	stats_local = (str_stats){ 0 };
+}
+
+int str_stats_dump(FILE* const stream, const str_stats* const stats) {
+	if(fprintf(stream, "%-32s %12s %16s %16s %12s %12s %16s\n",
+			   "function", "calls", "bytes in", "bytes out", "allocs", "reallocs", "bytes allocated") < 0)
+		return errno;
+
+	for(size_t i = 0; i < STR_STATS_COUNT; ++i) {
+		const str_stats_counters* const c = &stats->fn[i];
+
+		// skip functions never called
+		if(c->calls == 0 && c->allocs == 0 && c->reallocs == 0)
+			continue;
+
+		if(fprintf(stream, "%-32s %12" PRIu64 " %16" PRIu64 " %16" PRIu64 " %12" PRIu64 " %12" PRIu64 " %16" PRIu64 "\n",
+				   names[i], c->calls, c->bytes_in, c->bytes_out, c->allocs, c->reallocs, c->bytes_allocated) < 0)
+			return errno;
+	}
+
+	// allocation sizes
+	for(size_t i = 0; i < STR_STATS_CAT_COUNT; ++i) {
+		const str_stats_sizes* const s = &stats->sizes[i];
+
+		if(s->max_request == 0)
+			continue;
+
+		if(fprintf(stream, "\nallocation sizes (%s), max %" PRIu64 ":\n", category_names[i], s->max_request) < 0)
+			return errno;
+
+		for(size_t j = 0; j < STR_STATS_BUCKETS; ++j)
+			if(s->hist[j] > 0
+			   && fprintf(stream, "  [2^%zu, 2^%zu) %16" PRIu64 "\n", j, j + 1, s->hist[j]) < 0)
+				return errno;
+	}
+
+	return 0;
+}
+
+#endif	// STR_STATS
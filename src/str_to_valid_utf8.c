@@ -32,44 +32,81 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "str_impl.h"
 
-size_t str_to_valid_utf8(str* const dest) {
-	const char* p = str_ptr(*dest);
-	const char* const end = str_end(*dest);
+// U+FFFD
+#define REPL		"\xEF\xBF\xBD"
+#define REPL_LEN	(sizeof(REPL) - 1)
 
-	if(p == end)
-		return 0;
+// number of bytes processed by the decoder after an invalid sequence
+#define INVALID_BLOCK	16
 
-	str_builder sb;
+// the valid spans are skipped by the vectorised validator, and the blocks with invalid sequences
+// are processed by the decoder; returns the size of the result, which is only written out
+// if `dest` is not NULL
+static
+size_t repair(const char* p, const char* const end, char* dest, size_t* const nrep) {
+	size_t n = 0;
 
-	sb_init(&sb);
+	while(p < end) {
+		// valid span
+		const char* s = p;
 
-	size_t nrep = 0;
-	const char* s = p;
+		p += utf8_span_valid(p, end - p);
 
-	while(p < end) {
-		const str_decode_result r = str_decode_utf8(p, end - p);
+		// invalid block
+		const char* const stop = (end - p > INVALID_BLOCK) ? (p + INVALID_BLOCK) : end;
 
-		if(r.status == STR_UTF8_OK) {
-			p += r.num_bytes;
-			continue;
-		}
+		while(p < stop) {
+			const str_decode_result r = str_decode_utf8(p, end - p);
+
+			if(r.status == STR_UTF8_OK) {
+				p += r.num_bytes;
+				continue;
+			}
+
+			n += (p - s) + REPL_LEN;
+
+			if(dest)
+				dest = mem_append(mem_append(dest, s, p - s), REPL, REPL_LEN);
+
+			++*nrep;
 
-		sb_append_mem(&sb, s, p - s);
-		sb_append(&sb, str_lit("\xEF\xBF\xBD")); // U+FFFD
+			p += (r.status == STR_UTF8_INCOMPLETE || r.num_bytes == 1)
+			   ? r.num_bytes
+			   : (r.num_bytes - 1);
 
-		++nrep;
+			s = p;
+		}
 
-		p += (r.status == STR_UTF8_INCOMPLETE || r.num_bytes == 1)
-		   ? r.num_bytes
-		   : (r.num_bytes - 1);
+		n += p - s;
 
-		s = p;
+		if(dest)
+			dest = mem_append(dest, s, p - s);
 	}
 
-	sb_append_mem(&sb, s, end - s);
+	return n;
+}
+
+size_t str_to_valid_utf8(str* const dest) {
+	STATS_CALL_STR(str_to_valid_utf8, str_len(*dest), dest);
+
+	const char* const src = str_ptr(*dest);
+	const char* const end = str_end(*dest);
+	const size_t valid = utf8_span_valid(src, end - src);
+
+	if(src + valid == end)
+		return 0;
+
+	// count invalid sequences and the result size
+	size_t nrep = 0;
+	const size_t n = valid + repair(src + valid, end, NULL, &nrep);
+
+	// replacement
+	char* const buff = mem_alloc(n + 1);
 
-	if(nrep > 0)
-		assign_sb(dest, &sb);
+	nrep = 0;
+	repair(src + valid, end, mem_append(buff, src, valid), &nrep);
+	buff[n] = 0;
 
+	str_assign(dest, mem_acquire(buff, n));
 	return nrep;
 }
@@ -33,6 +33,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "str_impl.h"
 
 size_t str_unique_partition_array(str* const array, const size_t count) {
+	STATS_CALL(str_unique_partition_array, 0);
+
 	if(!array || count == 0)
 		return 0;
 
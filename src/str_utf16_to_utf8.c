@@ -0,0 +1,241 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// UTF-16 to UTF-8 conversion. The first pass validates the surrogate pairs and calculates the size
+// of the result, and the second pass converts. The vectorised version processes 16 code units at
+// a time: in the first pass as long as they contain no surrogates, and in the second pass as long
+// as they are ASCII, falling back to the scalar code for everything else.
+
+// load 16-bit code unit
+static inline
+uint32_t get_unit(const char* const s, const bool be) {
+	const uint8_t* const p = (const uint8_t*)s;
+
+	return be ? ((p[0] << 8) | p[1]) : ((p[1] << 8) | p[0]);
+}
+
+// validate and measure one code unit or surrogate pair, returning NULL if invalid
+static inline
+const char* measure_one(const char* const s, const char* const end, const bool be, size_t* const n) {
+	const uint32_t u = get_unit(s, be);
+
+	if((u & 0xF800) != 0xD800) {
+		*n += (u < 0x80) ? 1 : (u < 0x800) ? 2 : 3;
+		return s + 2;
+	}
+
+	if(u < 0xDC00 && end - s >= 4 && (get_unit(s + 2, be) & 0xFC00) == 0xDC00) {
+		*n += 4;
+		return s + 4;
+	}
+
+	return NULL;
+}
+
+// convert one code unit or surrogate pair of a valid string
+static inline
+const char* convert_one(const char* const s, char** const p, const bool be) {
+	const uint32_t u = get_unit(s, be);
+
+	if((u & 0xF800) != 0xD800) {
+		*p += utf8_encode(*p, u);
+		return s + 2;
+	}
+
+	*p += utf8_encode(*p, 0x10000 + ((u - 0xD800) << 10) + (get_unit(s + 2, be) - 0xDC00));
+	return s + 4;
+}
+
+// scalar versions; measure returns the pointer to the first invalid unit, or `end`
+static
+const char* measure_scalar(const char* s, const char* const end, const bool be, size_t* const n) {
+	for(const char* p; s < end && (p = measure_one(s, end, be, n)); s = p);
+
+	return s;
+}
+
+static
+void convert_scalar(const char* s, const char* const end, char* p, char* const p_end, const bool be) {
+	(void)p_end;
+
+	while(s < end)
+		s = convert_one(s, &p, be);
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+// load 8 code units
+__attribute__((target("sse2"), always_inline))
+static inline
+__m128i load_units(const char* const s, const bool be) {
+	const __m128i v = _mm_loadu_si128((const __m128i*)s);
+
+	return be ? _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)) : v;
+}
+
+// number of units in `a` and `b` with the bits of `mask` not set
+__attribute__((target("sse2,popcnt"), always_inline))
+static inline
+size_t count_below(const __m128i a, const __m128i b, const short mask) {
+	const __m128i m = _mm_set1_epi16(mask);
+	const __m128i zero = _mm_setzero_si128();
+
+	return __builtin_popcount(_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(a, m), zero),
+																_mm_cmpeq_epi16(_mm_and_si128(b, m), zero))));
+}
+
+// SSE2 versions
+__attribute__((target("sse2,popcnt")))
+static
+const char* measure_sse2(const char* s, const char* const end, const bool be, size_t* const n) {
+	while(s < end) {
+		if(end - s >= 32) {
+			const __m128i a = load_units(s, be);
+			const __m128i b = load_units(s + 16, be);
+			const __m128i sm = _mm_set1_epi16((short)0xF800), sv = _mm_set1_epi16((short)0xD800);
+
+			if(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(_mm_and_si128(a, sm), sv),
+											  _mm_cmpeq_epi16(_mm_and_si128(b, sm), sv))) == 0) {
+				// 1 byte per unit, plus 1 for each unit above 0x7F, plus 1 for each unit above 0x7FF
+				*n += 48 - count_below(a, b, (short)0xFF80) - count_below(a, b, (short)0xF800);
+				s += 32;
+				continue;
+			}
+
+			// block with surrogates; the last pair may extend past the block
+			for(const char* const stop = s + 32; s < stop; ) {
+				const char* const p = measure_one(s, end, be, n);
+
+				if(!p)
+					return s;
+
+				s = p;
+			}
+
+			continue;
+		}
+
+		return measure_scalar(s, end, be, n);
+	}
+
+	return s;
+}
+
+// vector stores require at least 16 bytes of the output space, and may write past the bytes
+// actually converted, which are overwritten later
+__attribute__((target("sse2")))
+static
+void convert_sse2(const char* s, const char* const end, char* p, char* const p_end, const bool be) {
+	while(s < end) {
+		if(end - s >= 32 && p_end - p >= 16) {
+			const __m128i a = load_units(s, be);
+			const __m128i b = load_units(s + 16, be);
+			const __m128i m = _mm_set1_epi16((short)0xFF80);
+			const __m128i zero = _mm_setzero_si128();
+			const unsigned ascii = (unsigned)_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(a, m), zero),
+																			   _mm_cmpeq_epi16(_mm_and_si128(b, m), zero)));
+
+			// leading ASCII units
+			if(ascii & 1) {
+				const size_t k = (ascii == 0xFFFF) ? 16 : __builtin_ctz(~ascii);
+
+				_mm_storeu_si128((__m128i*)p, _mm_packus_epi16(a, b));
+
+				s += 2 * k;
+				p += k;
+				continue;
+			}
+		}
+
+		s = convert_one(s, &p, be);
+	}
+}
+
+// implementation selection
+static const char* (*measure_impl)(const char*, const char* const, const bool, size_t* const) = measure_scalar;
+static void (*convert_impl)(const char*, const char* const, char*, char* const, const bool) = convert_scalar;
+
+__attribute__((constructor))
+static
+void select_convert_impl(void) {
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("sse2")) {
+		convert_impl = convert_sse2;
+
+		if(__builtin_cpu_supports("popcnt"))
+			measure_impl = measure_sse2;
+	}
+}
+
+#else	// no SIMD
+
+#define measure_impl	measure_scalar
+#define convert_impl	convert_scalar
+
+#endif
+
+size_t str_utf16_to_utf8(str* const dest, const str s, const bool big_endian) {
+	STATS_CALL_STR(str_utf16_to_utf8, str_len(s), dest);
+
+	const char* const src = str_ptr(s);
+	const size_t len = str_len(s);
+	const char* const end = src + (len & ~(size_t)1);
+
+	// validation and the result size
+	size_t n = 0;
+	const char* const p = measure_impl(src, end, big_endian, &n);
+
+	if(p != end)
+		return p - src;
+
+	if(end != src + len)
+		return len - 1;	// odd trailing byte
+
+	if(n == 0) {
+		str_clear(dest);
+		return 0;
+	}
+
+	// conversion
+	char* const buff = mem_alloc(n + 1);
+
+	convert_impl(src, end, buff, buff + n, big_endian);
+	buff[n] = 0;
+
+	str_assign(dest, mem_acquire(buff, n));
+	return len;
+}
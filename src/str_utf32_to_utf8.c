@@ -0,0 +1,190 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// UTF-32 to UTF-8 conversion. The first pass validates the codepoints and calculates the size
+// of the result, and the second pass converts. The vectorised version processes 16 codepoints at
+// a time as long as they are ASCII, falling back to the scalar code for everything else.
+
+// load one codepoint
+static inline
+uint32_t get_codepoint(const char* const s, const bool be) {
+	const uint8_t* const p = (const uint8_t*)s;
+
+	return be ? (((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3])
+			  : (((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0]);
+}
+
+// scalar versions; measure returns the pointer to the first invalid codepoint, or `end`
+static
+const char* measure_scalar(const char* s, const char* const end, const bool be, size_t* const n) {
+	char tmp[4];
+
+	for(; s < end; s += 4) {
+		const size_t k = utf8_encode(tmp, get_codepoint(s, be));
+
+		if(k == 0)
+			break;
+
+		*n += k;
+	}
+
+	return s;
+}
+
+static
+char* convert_scalar(const char* s, const char* const end, char* p, const bool be) {
+	for(; s < end; s += 4)
+		p += utf8_encode(p, get_codepoint(s, be));
+
+	return p;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+// load 16 codepoints, and pack them into bytes if they are all ASCII
+__attribute__((target("sse2"), always_inline))
+static inline
+bool load_ascii(const char* const s, const bool be, __m128i* const res) {
+	__m128i v[4];
+
+	for(int i = 0; i < 4; ++i) {
+		v[i] = _mm_loadu_si128((const __m128i*)(s + 16 * i));
+
+		if(be) {	// byte swap
+			v[i] = _mm_or_si128(_mm_slli_epi16(v[i], 8), _mm_srli_epi16(v[i], 8));
+			v[i] = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v[i], 0xB1), 0xB1);
+		}
+	}
+
+	const __m128i x = _mm_or_si128(_mm_or_si128(v[0], v[1]), _mm_or_si128(v[2], v[3]));
+
+	if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(x, _mm_set1_epi32((int)0xFFFFFF80)), _mm_setzero_si128())) != 0xFFFF)
+		return false;
+
+	*res = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+	return true;
+}
+
+// SSE2 versions
+__attribute__((target("sse2")))
+static
+const char* measure_sse2(const char* s, const char* const end, const bool be, size_t* const n) {
+	__m128i v;
+
+	for(; end - s >= 64; s += 64) {
+		if(load_ascii(s, be, &v)) {
+			*n += 16;
+		} else {
+			const char* const p = measure_scalar(s, s + 64, be, n);
+
+			if(p < s + 64)
+				return p;
+		}
+	}
+
+	return measure_scalar(s, end, be, n);
+}
+
+__attribute__((target("sse2")))
+static
+char* convert_sse2(const char* s, const char* const end, char* p, const bool be) {
+	__m128i v;
+
+	for(; end - s >= 64; s += 64) {
+		if(load_ascii(s, be, &v)) {
+			_mm_storeu_si128((__m128i*)p, v);
+			p += 16;
+		} else {
+			p = convert_scalar(s, s + 64, p, be);
+		}
+	}
+
+	return convert_scalar(s, end, p, be);
+}
+
+// implementation selection
+static const char* (*measure_impl)(const char*, const char* const, const bool, size_t* const) = measure_scalar;
+static char* (*convert_impl)(const char*, const char* const, char*, const bool) = convert_scalar;
+
+__attribute__((constructor))
+static
+void select_convert_impl(void) {
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("sse2")) {
+		measure_impl = measure_sse2;
+		convert_impl = convert_sse2;
+	}
+}
+
+#else	// no SIMD
+
+#define measure_impl	measure_scalar
+#define convert_impl	convert_scalar
+
+#endif
+
+size_t str_utf32_to_utf8(str* const dest, const str s, const bool big_endian) {
+	STATS_CALL_STR(str_utf32_to_utf8, str_len(s), dest);
+
+	const char* const src = str_ptr(s);
+	const size_t len = str_len(s);
+	const char* const end = src + (len & ~(size_t)3);
+
+	// validation and the result size
+	size_t n = 0;
+	const char* const p = measure_impl(src, end, big_endian, &n);
+
+	if(p != end)
+		return p - src;
+
+	if(end != src + len)
+		return end - src;	// incomplete trailing codepoint
+
+	if(n == 0) {
+		str_clear(dest);
+		return 0;
+	}
+
+	// conversion
+	char* const buff = mem_alloc(n + 1);
+
+	convert_impl(src, end, buff, big_endian);
+	buff[n] = 0;
+
+	str_assign(dest, mem_acquire(buff, n));
+	return len;
+}
@@ -0,0 +1,175 @@
+/*
+BSD 3-Clause License
+
+Copyright (c) 2025 Maxim Konakov
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "str_impl.h"
+
+// UTF-8 to UTF-32 conversion. The input is validated first, and the size of the result is
+// calculated from the number of codepoints. The vectorised version converts 16 bytes at a time
+// as long as they are ASCII, or a run of 2-byte sequences, and falls back to the scalar code
+// for everything else.
+
+// store one codepoint
+static inline
+char* put_codepoint(char* const p, const uint32_t cp, const bool be) {
+	p[be ? 0 : 3] = (char)(cp >> 24);
+	p[be ? 1 : 2] = (char)(cp >> 16);
+	p[be ? 2 : 1] = (char)(cp >> 8);
+	p[be ? 3 : 0] = (char)cp;
+
+	return p + 4;
+}
+
+// scalar version
+static
+void convert_scalar(const char* s, const char* const end, char* p, char* const p_end, const bool be) {
+	(void)p_end;
+
+	while(s < end) {
+		const str_decode_result r = str_decode_utf8(s, end - s);
+
+		p = put_codepoint(p, r.codepoint, be);
+		s += r.num_bytes;
+	}
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+// store 8 codepoints from the 16-bit lanes of `v`
+__attribute__((target("sse2"), always_inline))
+static inline
+void store_codepoints(char* const p, const __m128i v, const bool be) {
+	const __m128i zero = _mm_setzero_si128();
+
+	if(be) {	// byte-swapped lanes go to the upper halves
+		const __m128i x = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+		_mm_storeu_si128((__m128i*)p, _mm_unpacklo_epi16(zero, x));
+		_mm_storeu_si128((__m128i*)(p + 16), _mm_unpackhi_epi16(zero, x));
+	} else {
+		_mm_storeu_si128((__m128i*)p, _mm_unpacklo_epi16(v, zero));
+		_mm_storeu_si128((__m128i*)(p + 16), _mm_unpackhi_epi16(v, zero));
+	}
+}
+
+// SSE2 version; vector stores require at least 64 bytes of the output space, and may write
+// past the codepoints actually converted, which are overwritten later
+__attribute__((target("sse2")))
+static
+void convert_sse2(const char* s, const char* const end, char* p, char* const p_end, const bool be) {
+	const __m128i zero = _mm_setzero_si128();
+
+	while(s < end) {
+		if(end - s >= 16 && p_end - p >= 64) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)s);
+			const unsigned m = (unsigned)_mm_movemask_epi8(v);
+
+			// leading ASCII bytes
+			if((m & 1) == 0) {
+				const size_t k = (m == 0) ? 16 : __builtin_ctz(m);
+
+				store_codepoints(p, _mm_unpacklo_epi8(v, zero), be);
+				store_codepoints(p + 32, _mm_unpackhi_epi8(v, zero), be);
+
+				s += k;
+				p += 4 * k;
+				continue;
+			}
+
+			// leading 2-byte sequences, as 16-bit lanes with the lead byte in the low half
+			const unsigned m2 = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xC0E0)),
+																			  _mm_set1_epi16((short)0x80C0)));
+
+			if(m2 & 1) {
+				const size_t k = (m2 == 0xFFFF) ? 8 : (__builtin_ctz(~m2) / 2);
+
+				store_codepoints(p, _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x1F)), 6),
+												 _mm_and_si128(_mm_srli_epi16(v, 8), _mm_set1_epi16(0x3F))),
+								 be);
+
+				s += 2 * k;
+				p += 4 * k;
+				continue;
+			}
+		}
+
+		const str_decode_result r = str_decode_utf8(s, end - s);
+
+		p = put_codepoint(p, r.codepoint, be);
+		s += r.num_bytes;
+	}
+}
+
+// implementation selection
+static void (*convert_impl)(const char*, const char* const, char*, char* const, const bool) = convert_scalar;
+
+__attribute__((constructor))
+static
+void select_convert_impl(void) {
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("sse2"))
+		convert_impl = convert_sse2;
+}
+
+#else	// no SIMD
+
+#define convert_impl	convert_scalar
+
+#endif
+
+size_t str_utf8_to_utf32(str* const dest, const str s, const bool big_endian) {
+	STATS_CALL_STR(str_utf8_to_utf32, str_len(s), dest);
+
+	const char* const src = str_ptr(s);
+	const size_t len = str_len(s);
+	const size_t valid = utf8_span_valid(src, len);
+
+	if(valid < len)
+		return valid;
+
+	if(len == 0) {
+		str_clear(dest);
+		return 0;
+	}
+
+	// conversion
+	const size_t n = 4 * utf8_count_starts(src, src + len);
+	char* const buff = mem_alloc(n + 1);
+
+	convert_impl(src, src + len, buff, buff + n, big_endian);
+	buff[n] = 0;
+
+	str_assign(dest, mem_acquire(buff, n));
+	return len;
+}
@@ -128,6 +128,115 @@ TEST_CASE(test_clone) {
 	TEST(strlen(str_ptr(s)) == str_len(s));
 }
 
+TEST_CASE(test_share) {
+	str s1 = str_null, s2 = str_null;
+
+	// shared copy
+	str_share(&s1, Lit("xxx"));
+
+	TEST(str_is_shared(s1));
+	TEST(str_is_owner(s1));
+	TEST(!str_is_ref(s1));
+	TEST(str_eq(s1, Lit("xxx")));
+	TEST(strlen(str_ptr(s1)) == str_len(s1));
+
+	// another reference to the same memory
+	str_share(&s2, s1);
+
+	TEST(str_is_shared(s2));
+	TEST(str_ptr(s1) == str_ptr(s2));
+
+	// slices and references are not counted
+	const str r = str_ref_slice(s1, 1, 3);
+
+	TEST(str_is_ref(r));
+	TEST(str_eq(r, Lit("xx")));
+
+	// the memory stays alive until the last share is released
+	str_clear(&s1);
+
+	TEST(str_eq(s2, Lit("xxx")));
+
+	// cloning makes an exclusive copy
+	str_clone(&s1, s2);
+
+	TEST(str_is_owner(s1));
+	TEST(!str_is_shared(s1));
+	TEST(str_ptr(s1) != str_ptr(s2));
+
+	// self-assignment
+	str_share(&s2, s2);
+
+	TEST(str_eq(s2, Lit("xxx")));
+
+	// ownership transfer
+	str s3 = str_acquire(&s2);
+
+	TEST(str_is_ref(s2));
+	TEST(str_is_shared(s3));
+
+	str_share(&s1, str_null);
+
+	TEST(str_is_empty(s1));
+	TEST(str_is_ref(s1));
+
+	str_free(s3);
+}
+
+#include <pthread.h>
+
+static
+void* share_worker(void* arg) {
+	for(int i = 0; i < 10000; ++i) {
+		str s = str_null;
+
+		str_share(&s, *(const str*)arg);
+		str_free(s);
+	}
+
+	return NULL;
+}
+
+TEST_CASE(test_share_threads) {
+	str s = str_null;
+
+	str_share(&s, Lit("xxx"));
+
+	pthread_t t[4];
+
+	for(int i = 0; i < 4; ++i)
+		TEST(pthread_create(&t[i], NULL, share_worker, &s) == 0);
+
+	for(int i = 0; i < 4; ++i)
+		TEST(pthread_join(t[i], NULL) == 0);
+
+	TEST(str_eq(s, Lit("xxx")));
+
+	str_free(s);
+}
+
+static
+void* share_pool_worker(void* arg) {
+	str_set_thread_allocator(&str_pool_allocator);
+	str_share((str*)arg, Lit("xxx"));
+	str_set_thread_allocator(NULL);
+	return NULL;
+}
+
+TEST_CASE(test_share_handover) {
+	str s = str_null;
+	pthread_t t;
+
+	// shared string allocated from the pool of another thread, and released here
+	TEST(pthread_create(&t, NULL, share_pool_worker, &s) == 0);
+	TEST(pthread_join(t, NULL) == 0);
+
+	TEST(str_is_shared(s));
+	TEST(str_eq(s, Lit("xxx")));
+
+	str_free(s);
+}
+
 TEST_CASE(test_swap) {
 	str s1 = Lit("x"), s2 = Lit("y");
 
@@ -239,6 +348,12 @@ TEST_CASE(test_concat) {
 	TEST(str_eq(s, Lit("aaabbb")));
 	TEST(strlen(str_ptr(s)) == str_len(s));
 
+	// self-overlapping
+	str_concat(&s, s, str_ref_slice(s, 0, 3), s);
+
+	TEST(str_eq(s, Lit("aaabbbaaaaaabbb")));
+	TEST(strlen(str_ptr(s)) == str_len(s));
+
 	str_free(s);
 }
 
@@ -324,6 +439,359 @@ TEST_CASE(test_repeat) {
 	TEST(strlen(str_ptr(s)) == str_len(s));
 }
 
+TEST_CASE(test_builder) {
+	str_auto s = Lit("xxx");
+	str_builder sb = str_builder_null;
+
+	// empty builder
+	str_builder_finish(&s, &sb);
+
+	TEST(str_is_empty(s));
+	TEST(str_is_ref(s));
+
+	// appends
+	str_builder_append_str(&sb, Lit("abc"));
+	str_builder_append_mem(&sb, "def", 3);
+	str_builder_append_char(&sb, '-');
+
+	TEST(str_builder_append_codepoint(&sb, 0x20AC) == 3);
+	TEST(str_builder_append_codepoint(&sb, 0xD800) == 0);
+
+	str_builder_finish(&s, &sb);
+
+	TEST(str_eq(s, Lit("abcdef-\xE2\x82\xAC")));
+	TEST(str_is_owner(s));
+	TEST(strlen(str_ptr(s)) == str_len(s));
+	TEST(sb.ptr == NULL && sb.len == 0 && sb.cap == 0);
+
+	// big string
+	const size_t N = 10000;
+
+	for(size_t i = 0; i < N; ++i)
+		str_builder_append_char(&sb, 'x');
+
+	TEST(sb.len == N);
+	TEST(sb.cap > N);
+
+	str_builder_finish(&s, &sb);
+
+	TEST(str_len(s) == N);
+	TEST(str_span_chars(s, Lit("x")) == N);
+	TEST(strlen(str_ptr(s)) == str_len(s));
+
+	// discard
+	str_builder_append_str(&sb, s);
+	str_builder_free(&sb);
+
+	TEST(sb.ptr == NULL && sb.len == 0 && sb.cap == 0);
+}
+
+// counting allocator
+typedef struct {
+	size_t allocs, reallocs, frees;
+} alloc_counters;
+
+static
+void* test_alloc(void* ctx, size_t n) {
+	++((alloc_counters*)ctx)->allocs;
+	return malloc(n);
+}
+
+static
+void* test_realloc(void* ctx, void* p, size_t n) {
+	++((alloc_counters*)ctx)->reallocs;
+	return realloc(p, n);
+}
+
+static
+void test_free(void* ctx, void* p) {
+	++((alloc_counters*)ctx)->frees;
+	free(p);
+}
+
+TEST_CASE(test_allocator) {
+	alloc_counters cnt = { 0 };
+
+	const str_allocator a = {
+		.alloc = test_alloc,
+		.realloc = test_realloc,
+		.free = test_free,
+		.ctx = &cnt
+	};
+
+	TEST(str_get_allocator() == NULL);
+
+	str_set_thread_allocator(&a);
+
+	TEST(str_get_allocator() == &a);
+
+	str s = str_null;
+
+	str_clone(&s, Lit("xxx"));
+	str_concat(&s, s, Lit("yyy"));
+
+	TEST(str_eq(s, Lit("xxxyyy")));
+	TEST(str_replace_substring(&s, Lit("y"), Lit("z")) == 3);
+	TEST(str_eq(s, Lit("xxxzzz")));
+
+	str_free(s);
+
+	// both the concatenation and the replacement are done in place
+	TEST(cnt.allocs == 1);
+	TEST(cnt.reallocs == 1);
+	TEST(cnt.frees == 1);
+
+	// strings are freed by the allocator they came from
+	str t = str_null;
+
+	s = str_null;
+	str_clone(&t, Lit("zzz"));
+	str_set_thread_allocator(NULL);
+	str_clone(&s, Lit("xxx"));
+	str_free(t);
+
+	TEST(cnt.allocs == 2);
+	TEST(cnt.frees == 2);
+
+	str_set_thread_allocator(&a);
+	str_free(s);
+
+	TEST(cnt.frees == 2);
+
+	// memory from malloc is taken over as is, and freed with free()
+	char* const p = malloc(4);
+
+	memcpy(p, "abc", 4);
+	s = str_acquire_mem(p, 3);
+
+	TEST(str_ptr(s) == p);
+	TEST(str_eq(s, Lit("abc")));
+
+	str_free(s);
+
+	TEST(cnt.frees == 2);
+
+	// growing moves it to the allocator in effect
+	s = str_acquire_ptr(memcpy(malloc(4), "abc", 4));
+	str_concat(&s, s, Lit("def"));
+
+	TEST(str_eq(s, Lit("abcdef")));
+	TEST(cnt.allocs == 3);
+
+	str_free(s);
+
+	TEST(cnt.frees == 3);
+
+	str_set_thread_allocator(NULL);
+
+	TEST(str_get_allocator() == NULL);
+}
+
+TEST_CASE(test_concat_append) {
+	alloc_counters cnt = { 0 };
+
+	const str_allocator a = {
+		.alloc = test_alloc,
+		.realloc = test_realloc,
+		.free = test_free,
+		.ctx = &cnt
+	};
+
+	str_set_thread_allocator(&a);
+
+	str s = str_null;
+	const size_t N = 10000;
+
+	str_clone(&s, Lit("x"));
+
+	for(size_t i = 1; i < N; ++i)
+		str_concat(&s, s, Lit("x"));
+
+	TEST(str_len(s) == N);
+	TEST(str_span_chars(s, Lit("x")) == N);
+	TEST(strlen(str_ptr(s)) == N);
+	TEST(str_is_owner(s));
+	TEST(!str_is_shared(s));
+
+	// amortised growth
+	TEST(cnt.allocs == 1);
+	TEST(cnt.reallocs < 20);
+
+	for(size_t i = 0; i < N; ++i)
+		str_join(&s, Lit(","), s, Lit("y"));
+
+	TEST(str_len(s) == 3 * N);
+	TEST(str_span_chars(s, Lit("x")) == N);
+	TEST(str_has_suffix(s, Lit(",y,y")));
+	TEST(strlen(str_ptr(s)) == 3 * N);
+	TEST(cnt.allocs == 1);
+	TEST(cnt.reallocs < 40);
+
+	// the string remains usable as an ordinary owner
+	TEST(str_replace_substring(&s, Lit(",y"), Lit("z")) == N);
+	TEST(str_len(s) == 2 * N);
+
+	str_concat(&s, s, Lit("!"));
+
+	TEST(str_len(s) == 2 * N + 1);
+	TEST(str_has_suffix(s, Lit("zz!")));
+
+	str_share(&s, s);
+	str_concat(&s, s, Lit("!"));
+
+	TEST(str_has_suffix(s, Lit("zz!!")));
+
+	str_free(s);
+	str_set_thread_allocator(NULL);
+
+	TEST(cnt.frees == cnt.allocs);
+}
+
+
+TEST_CASE(test_arena) {
+	alloc_counters cnt = { 0 };
+
+	const str_allocator a = {
+		.alloc = test_alloc,
+		.realloc = test_realloc,
+		.free = test_free,
+		.ctx = &cnt
+	};
+
+	str_set_thread_allocator(&a);
+
+	str_arena arena;
+
+	str_arena_init(&arena, 1024);
+
+	str s = str_null, s2 = str_null;
+
+	for(int i = 0; i < 100; ++i) {
+		str_arena_clone(&arena, &s, Lit("xxx"));
+		str_arena_concat(&arena, &s, s, Lit("-"), s);
+
+		TEST(str_eq(s, Lit("xxx-xxx")));
+		TEST(str_is_ref(s));
+
+		str_arena_join(&arena, &s, Lit(", "), s, Lit("yyy"));
+
+		TEST(str_eq(s, Lit("xxx-xxx, yyy")));
+		TEST(str_is_ref(s));
+
+		TEST(str_arena_replace_substring(&arena, &s, Lit("xxx"), Lit("z")) == 2);
+		TEST(str_eq(s, Lit("z-z, yyy")));
+		TEST(str_arena_replace_chars(&arena, &s, Lit("-,"), Lit("_")) == 2);
+		TEST(str_eq(s, Lit("z_z_ yyy")));
+		TEST(str_arena_replace_char_spans(&arena, &s, Lit("_ "), str_null) == 2);
+		TEST(str_eq(s, Lit("zzyyy")));
+		TEST(str_is_ref(s));
+
+		TEST(str_arena_sprintf(&arena, &s2, "%d:%.*s", i, (int)str_len(s), str_ptr(s)));
+		TEST(str_is_ref(s2));
+		TEST(strlen(str_ptr(s2)) == str_len(s2));
+
+		// no match, no change
+		TEST(str_arena_replace_substring(&arena, &s, Lit("?"), Lit("!")) == 0);
+		TEST(str_eq(s, Lit("zzyyy")));
+	}
+
+	TEST(str_eq(s2, Lit("99:zzyyy")));
+	TEST(cnt.frees == 0);
+
+	// the arena is no longer the thread allocator
+	str_clone(&s2, s2);
+
+	TEST(str_is_owner(s2));
+
+	str_free(s2);
+
+	// reset and reuse
+	const size_t allocs = cnt.allocs;
+
+	str_arena_reset(&arena);
+
+	for(int i = 0; i < 100; ++i)
+		str_arena_concat(&arena, &s, Lit("abc"), Lit("def"));
+
+	TEST(str_eq(s, Lit("abcdef")));
+	TEST(cnt.allocs == allocs);
+
+	// big allocation
+	str_arena_clone(&arena, &s, Lit("x"));
+
+	for(int i = 0; i < 12; ++i)
+		str_arena_concat(&arena, &s, s, s);
+
+	TEST(str_len(s) == 4096);
+	TEST(str_span_chars(s, Lit("x")) == 4096);
+
+	str_arena_free(&arena);
+	str_set_thread_allocator(NULL);
+
+	TEST(cnt.frees == cnt.allocs);
+}
+
+TEST_CASE(test_pool) {
+	// allocated before installing the pool
+	str s = str_null, t = str_null;
+
+	str_clone(&t, Lit("zzz"));
+	str_set_thread_allocator(&str_pool_allocator);
+	str_concat(&t, t, Lit("zzz"));
+
+	TEST(str_eq(t, Lit("zzzzzz")));
+
+	str_free(t);
+	t = str_null;
+
+	str_clone(&s, Lit("xxx"));
+
+	const char* const p = str_ptr(s);
+
+	// the block is reused
+	str_clear(&s);
+	str_clone(&s, Lit("yyy"));
+
+	TEST(str_ptr(s) == p);
+	TEST(str_eq(s, Lit("yyy")));
+
+	// growing through size classes and beyond
+	str_builder sb = str_builder_null;
+
+	for(int i = 0; i < 1000; ++i)
+		str_builder_append_str(&sb, Lit("abc"));
+
+	str_builder_finish(&s, &sb);
+
+	TEST(str_len(s) == 3000);
+	TEST(str_has_prefix(s, Lit("abcabc")));
+	TEST(str_has_suffix(s, Lit("abcabc")));
+
+	str_replace_substring(&s, Lit("abc"), Lit("z"));
+
+	TEST(str_len(s) == 1000);
+	TEST(str_span_chars(s, Lit("z")) == 1000);
+
+	str_clear(&s);
+
+	// no caching
+	str_pool_set_limit(16, 0);
+	str_clone(&s, Lit("xxx"));
+	str_clear(&s);
+	str_pool_set_limit(16, 1024);
+
+	// freed after removing the pool
+	str_clone(&t, Lit("yyy"));
+	str_set_thread_allocator(NULL);
+	str_concat(&t, t, Lit("yyy"));
+
+	TEST(str_eq(t, Lit("yyyyyy")));
+
+	str_free(t);
+
+	str_pool_trim();
+}
+
 TEST_CASE(test_hash) {
 	// better ideas on how to test it?
 	TEST(str_hash(Lit("xxx")) == str_hash(Lit("xxx")));
@@ -382,6 +850,162 @@ TEST_CASE(test_span_nonmatching_chars) {
 	TEST(str_span_nonmatching_chars(Lit("xxx\0-x"), Lit("_/-")) == 4);
 }
 
+TEST_CASE(test_charset) {
+	str_charset cs;
+
+	// empty set
+	str_charset_init(&cs, str_null);
+
+	TEST(!str_charset_has(&cs, 0));
+	TEST(str_span_chars_cs(Lit("xxx"), &cs) == 0);
+	TEST(str_span_nonmatching_chars_cs(Lit("xxx"), &cs) == 3);
+
+	// small sets
+	const str text = Lit("aaa bbb\tccc\nddd   eee\t\t\n  fff, ggg;hhh");
+
+	str_charset_init(&cs, Lit("  \t\t"));
+
+	TEST(cs.n == 2);
+	TEST(str_charset_has(&cs, ' ') && str_charset_has(&cs, '\t') && !str_charset_has(&cs, '\n'));
+	TEST(str_span_nonmatching_chars_cs(text, &cs) == 3);
+	TEST(str_span_chars_cs(str_ref_slice(text, 3, str_len(text)), &cs) == 1);
+
+	str_charset_init(&cs, Lit("\n"));
+
+	TEST(cs.n == 1);
+	TEST(str_span_nonmatching_chars_cs(text, &cs) == 11);
+	TEST(str_span_nonmatching_chars_cs(Lit("0123456789abcdefghijklmnopqrstuvwxyz"), &cs) == 36);
+
+	// big set
+	str_charset_init(&cs, Lit(",; \t\n\xFF"));
+
+	TEST(cs.n == 0);
+	TEST(str_charset_has(&cs, '\xFF'));
+
+	str s = str_null;
+
+	str_clone(&s, text);
+
+	TEST(str_replace_chars_cs(&s, &cs, Lit("_")) == 14);
+	TEST(str_eq(s, Lit("aaa_bbb_ccc_ddd___eee_____fff__ggg_hhh")));
+
+	str_clone(&s, text);
+
+	TEST(str_replace_char_spans_cs(&s, &cs, Lit("_")) == 7);
+	TEST(str_eq(s, Lit("aaa_bbb_ccc_ddd_eee_fff_ggg_hhh")));
+
+	// same results as with the charset string
+	for(size_t i = 0; i < str_len(text); ++i) {
+		const str t = str_ref_slice(text, i, str_len(text));
+
+		TEST(str_span_chars_cs(t, &cs) == str_span_chars(t, Lit(",; \t\n\xFF")));
+		TEST(str_span_nonmatching_chars_cs(t, &cs) == str_span_nonmatching_chars(t, Lit(",; \t\n\xFF")));
+	}
+
+	str_free(s);
+}
+
+TEST_CASE(test_span_chars_long) {
+	// all byte values, in a long string
+	char buff[3 * 256];
+
+	for(size_t i = 0; i < sizeof(buff); ++i)
+		buff[i] = (char)(i * 7);
+
+	const str s = str_ref_mem(buff, sizeof(buff));
+	const str charsets[] = {
+		Lit(" \t\r\n"),
+		Lit("\x80\xFF\x7F\x00\x01"),
+		Lit("0123456789abcdefABCDEF"),
+	};
+
+	for(size_t k = 0; k < sizeof(charsets)/sizeof(charsets[0]); ++k) {
+		const str cs = charsets[k];
+
+		for(size_t i = 0; i < sizeof(buff); ++i) {
+			const str t = str_ref_slice(s, i, sizeof(buff));
+
+			// expected values
+			size_t n_nonmatching = 0;
+
+			while(n_nonmatching < str_len(t) && !memchr(str_ptr(cs), t.ptr[n_nonmatching], str_len(cs)))
+				++n_nonmatching;
+
+			TEST(str_span_nonmatching_chars(t, cs) == n_nonmatching);
+		}
+	}
+
+	// long spans
+	str_auto r = Lit(" \t");
+
+	str_repeat(&r, 100);
+
+	TEST(str_span_chars(r, Lit("\t ")) == 200);
+	TEST(str_span_chars(r, Lit(" ")) == 1);
+	TEST(str_span_nonmatching_chars(r, Lit("\n")) == 200);
+
+	str_concat(&r, r, Lit("x"), r);
+
+	TEST(str_span_chars(r, Lit("\t ")) == 200);
+	TEST(str_span_nonmatching_chars(r, Lit("x")) == 200);
+	TEST(str_span_nonmatching_chars(r, Lit("\xF8x")) == 200);
+}
+
+TEST_CASE(test_span_trailing_chars) {
+	TEST(str_span_trailing_chars(str_null, Lit("x")) == 0);
+	TEST(str_span_trailing_chars(Lit("x"), str_null) == 0);
+	TEST(str_span_trailing_chars(Lit("abc  \t"), Lit(" \t")) == 3);
+	TEST(str_span_trailing_chars(Lit(" \t"), Lit(" \t")) == 2);
+	TEST(str_span_trailing_nonmatching_chars(str_null, Lit("x")) == 0);
+	TEST(str_span_trailing_nonmatching_chars(Lit("xyz"), str_null) == 3);
+	TEST(str_span_trailing_nonmatching_chars(Lit("/usr/lib/libstr.a"), Lit("/")) == 8);
+	TEST(str_span_trailing_nonmatching_chars(Lit("libstr.a"), Lit("/")) == 8);
+
+	// all byte values, in a long string
+	char buff[3 * 256];
+
+	for(size_t i = 0; i < sizeof(buff); ++i)
+		buff[i] = (char)(i * 7);
+
+	const str s = str_ref_mem(buff, sizeof(buff));
+	const str charsets[] = {
+		Lit("/"),
+		Lit("\x80\xFF\x7F\x00\x01"),
+		Lit("0123456789abcdefABCDEF"),
+	};
+
+	for(size_t k = 0; k < sizeof(charsets)/sizeof(charsets[0]); ++k) {
+		const str cs = charsets[k];
+
+		for(size_t i = 0; i < sizeof(buff); ++i) {
+			const str t = str_ref_slice(s, 0, i);
+
+			// expected values
+			size_t n_nonmatching = 0;
+
+			while(n_nonmatching < i && !memchr(str_ptr(cs), t.ptr[i - 1 - n_nonmatching], str_len(cs)))
+				++n_nonmatching;
+
+			TEST(str_span_trailing_nonmatching_chars(t, cs) == n_nonmatching);
+		}
+	}
+
+	// long spans
+	str_auto r = Lit(" \t");
+
+	str_repeat(&r, 100);
+
+	TEST(str_span_trailing_chars(r, Lit("\t ")) == 200);
+	TEST(str_span_trailing_chars(r, Lit("\t")) == 1);
+	TEST(str_span_trailing_nonmatching_chars(r, Lit("\n")) == 200);
+
+	str_concat(&r, r, Lit("x"), r);
+
+	TEST(str_span_trailing_chars(r, Lit("\t ")) == 200);
+	TEST(str_span_trailing_nonmatching_chars(r, Lit("x")) == 200);
+	TEST(str_span_trailing_nonmatching_chars(r, Lit("\xF8x")) == 200);
+}
+
 TEST_CASE(test_span_until_str) {
 	TEST(str_span_until_substring(str_null, Lit("xxx")) == 0);
 	TEST(str_span_until_substring(Lit("xxx"), str_null) == 0);
@@ -390,6 +1014,369 @@ TEST_CASE(test_span_until_str) {
 	TEST(str_span_until_substring(Lit("xxx-yyy-zzz"), Lit("yyy")) == 4);
 	TEST(str_span_until_substring(Lit("xxx-yyy-zzz"), Lit("zzz")) == 8);
 	TEST(str_span_until_substring(Lit("xxx-yyy-zzz"), Lit("???")) == 11);
+
+	TEST(str_span_until_last_substring(str_null, Lit("xxx")) == 0);
+	TEST(str_span_until_last_substring(Lit("xxx-yyy-xxx"), Lit("xxx")) == 8);
+	TEST(str_span_until_last_substring(Lit("xxx-yyy-xxx"), Lit("yyy")) == 4);
+	TEST(str_span_until_last_substring(Lit("xxx-yyy-xxx"), Lit("???")) == 11);
+}
+
+TEST_CASE(test_finder) {
+	str_finder f;
+
+	// corner cases
+	str_finder_init(&f, str_null);
+
+	TEST(str_finder_first(&f, Lit("abc")) == 0);
+	TEST(str_finder_next(&f, Lit("abc"), 2) == 2);
+	TEST(str_finder_last(&f, Lit("abc")) == 3);
+
+	str_finder_init(&f, Lit("abc"));
+
+	TEST(str_finder_first(&f, str_null) == 0);
+	TEST(str_finder_first(&f, Lit("ab")) == 2);
+	TEST(str_finder_next(&f, Lit("abc"), 4) == 3);
+
+	// simple search
+	const str s = Lit("xxx-yyy-xxx-zzz");
+
+	str_finder_init(&f, Lit("xxx"));
+
+	TEST(str_finder_first(&f, s) == 0);
+	TEST(str_finder_next(&f, s, 1) == 8);
+	TEST(str_finder_next(&f, s, 9) == 15);
+	TEST(str_finder_last(&f, s) == 8);
+
+	str_finder_init(&f, Lit("-"));
+
+	TEST(str_finder_first(&f, s) == 3);
+	TEST(str_finder_last(&f, s) == 11);
+
+	// long strings, with needles both rare and periodic, where the last one makes the
+	// vectorised filter ineffective
+	char buff[1000];
+
+	for(size_t i = 0; i < sizeof(buff); ++i)
+		buff[i] = "ab"[(i * i) % 7 == 1];
+
+	memcpy(buff + 500, "0123456789", 10);
+
+	const str h = str_ref_mem(buff, sizeof(buff));
+	const str needles[] = {
+		Lit("0123456789"),
+		Lit("ab"),
+		Lit("bab"),
+		Lit("aaaaaa"),
+		Lit("abaaaab"),
+		Lit("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab"),
+	};
+
+	for(size_t k = 0; k < sizeof(needles)/sizeof(needles[0]); ++k) {
+		const str n = needles[k];
+
+		str_finder_init(&f, n);
+
+		// expected values
+		size_t last = sizeof(buff), next = sizeof(buff);
+
+		for(size_t i = sizeof(buff) - str_len(n) + 1; i-- > 0; ) {
+			if(memcmp(buff + i, str_ptr(n), str_len(n)) == 0) {
+				next = i;
+
+				if(last == sizeof(buff))
+					last = i;
+			}
+
+			TEST(str_finder_next(&f, h, i) == next);
+		}
+
+		TEST(str_finder_first(&f, h) == next);
+		TEST(str_finder_last(&f, h) == last);
+	}
+}
+
+TEST_CASE(test_find_all) {
+	size_t pos[8];
+
+	// corner cases
+	TEST(str_find_all_substring(str_null, Lit("x"), pos, 8) == 0);
+	TEST(str_find_all_substring(Lit("x"), str_null, pos, 8) == 0);
+	TEST(str_find_all_chars(str_null, Lit("x"), pos, 8) == 0);
+	TEST(str_find_all_chars(Lit("x"), str_null, pos, 8) == 0);
+
+	// substrings
+	const str s = Lit("xxx-yyy-xxxx-zzz");
+
+	TEST(str_find_all_substring(s, Lit("xx"), pos, 8) == 3);
+	TEST(pos[0] == 0 && pos[1] == 8 && pos[2] == 10);
+	TEST(str_find_all_substring(s, Lit("xx"), NULL, 0) == 3);
+	TEST(str_find_all_substring(s, Lit("-"), pos, 2) == 3);
+	TEST(pos[0] == 3 && pos[1] == 7);
+	TEST(str_find_all_substring(s, Lit("?"), pos, 8) == 0);
+
+	// chars, in a long string
+	char buff[300];
+
+	for(size_t i = 0; i < sizeof(buff); ++i)
+		buff[i] = (char)(i * 13);
+
+	const str charsets[] = { Lit("\n"), Lit("\x80\x01"), Lit(" \t\r\n"), Lit("0123456789\xFF") };
+
+	for(size_t k = 0; k < sizeof(charsets)/sizeof(charsets[0]); ++k) {
+		const str cs = charsets[k];
+
+		for(size_t i = 0; i < sizeof(buff); i += 7) {
+			const str t = str_ref_slice(str_ref_mem(buff, sizeof(buff)), i, sizeof(buff));
+
+			// expected values
+			size_t exp[sizeof(buff)], n = 0;
+
+			for(size_t j = 0; j < str_len(t); ++j)
+				if(memchr(str_ptr(cs), t.ptr[j], str_len(cs)))
+					exp[n++] = j;
+
+			// all offsets
+			size_t res[sizeof(buff)];
+
+			TEST(str_find_all_chars(t, cs, res, sizeof(buff)) == n);
+			TEST(memcmp(res, exp, n * sizeof(size_t)) == 0);
+
+			// some offsets, and count only
+			TEST(str_find_all_chars(t, cs, res, 2) == n);
+			TEST(memcmp(res, exp, ((n < 2) ? n : 2) * sizeof(size_t)) == 0);
+			TEST(str_find_all_chars(t, cs, NULL, 0) == n);
+		}
+	}
+}
+
+TEST_CASE(test_count) {
+	// corner cases
+	TEST(str_count_byte(str_null, 'x') == 0);
+	TEST(str_count_chars(str_null, Lit("x")) == 0);
+	TEST(str_count_chars(Lit("x"), str_null) == 0);
+	TEST(str_count_substring(str_null, Lit("x")) == 0);
+	TEST(str_count_substring(Lit("x"), str_null) == 0);
+
+	// short strings
+	TEST(str_count_byte(Lit("a\nb\n\n"), '\n') == 3);
+	TEST(str_count_chars(Lit("a\r\nb\n"), Lit("\r\n")) == 3);
+	TEST(str_count_substring(Lit("aaaaa"), Lit("aa")) == 2);
+	TEST(str_count_substring(Lit("a-b-c"), Lit("-")) == 2);
+
+	// long strings, at all offsets
+	char buff[300];
+
+	for(size_t i = 0; i < sizeof(buff); ++i)
+		buff[i] = (i % 7 == 0) ? '\n' : (char)(i * 13);
+
+	for(size_t i = 0; i < sizeof(buff); ++i) {
+		const str t = str_ref_mem(buff + i, sizeof(buff) - i);
+
+		// expected values
+		size_t n = 0, m = 0;
+
+		for(size_t j = i; j < sizeof(buff); ++j) {
+			n += (buff[j] == '\n');
+			m += (buff[j] == '\n' || buff[j] == '\xFF');
+		}
+
+		TEST(str_count_byte(t, '\n') == n);
+		TEST(str_count_substring(t, Lit("\n")) == n);
+		TEST(str_count_chars(t, Lit("\n\xFF")) == m);
+	}
+}
+
+TEST_CASE(test_line_index) {
+	str_line_index idx;
+
+	// empty text
+	str_line_index_init(&idx, 0);
+	str_line_index_update(&idx, str_null);
+
+	TEST(str_line_index_count(&idx) == 0);
+	TEST(str_is_empty(str_line_index_get(&idx, str_null, 0)));
+
+	str_line_index_free(&idx);
+
+	// short text, indexed incrementally
+	const str s = Lit("aaa\n\nbb\nc");
+
+	str_line_index_init(&idx, 0);
+	str_line_index_update(&idx, str_ref_slice(s, 0, 2));
+
+	TEST(str_line_index_count(&idx) == 1);
+	TEST(str_eq(str_line_index_get(&idx, s, 0), Lit("aa")));
+
+	str_line_index_update(&idx, str_ref_slice(s, 0, 4));
+
+	TEST(str_line_index_count(&idx) == 1);
+	TEST(str_eq(str_line_index_get(&idx, s, 0), Lit("aaa")));
+
+	str_line_index_update(&idx, s);
+
+	TEST(str_line_index_count(&idx) == 4);
+	TEST(str_eq(str_line_index_get(&idx, s, 0), Lit("aaa")));
+	TEST(str_is_empty(str_line_index_get(&idx, s, 1)));
+	TEST(str_eq(str_line_index_get(&idx, s, 2), Lit("bb")));
+	TEST(str_eq(str_line_index_get(&idx, s, 3), Lit("c")));
+	TEST(str_is_empty(str_line_index_get(&idx, s, 4)));
+
+	str_line_index_free(&idx);
+
+	// long text, with every line indexed, and sampled
+	str_builder sb = str_builder_null;
+	str_auto t = str_null;
+	char buff[40];
+
+	for(int i = 0; i < 1000; ++i)
+		str_builder_append_mem(&sb, buff, snprintf(buff, sizeof(buff), "%d\n", i));
+
+	str_builder_finish(&t, &sb);
+
+	for(unsigned shift = 0; shift < 4; shift += 3) {
+		str_line_index_init(&idx, shift);
+		str_line_index_update(&idx, t);
+
+		TEST(str_line_index_count(&idx) == 1000);
+
+		for(int i = 0; i < 1000; ++i) {
+			const str line = str_line_index_get(&idx, t, i);
+
+			TEST(str_eq(line, str_ref_mem(buff, snprintf(buff, sizeof(buff), "%d", i))));
+		}
+
+		str_line_index_free(&idx);
+	}
+}
+
+static
+bool split_is(str_split_iter* const it, const str* const exp, const size_t n) {
+	// array
+	str fields[10];
+
+	if(str_split_array(it, NULL, 0) != n || str_split_array(it, fields, 10) != n)
+		return false;
+
+	// iterator
+	str f;
+
+	for(size_t i = 0; i < n; ++i)
+		if(!str_eq(fields[i], exp[i]) || !str_split_next(it, &f) || !str_eq(f, exp[i]))
+			return false;
+
+	return !str_split_next(it, &f) && !str_split_next(it, &f);
+}
+
+TEST_CASE(test_split) {
+	str_split_iter it;
+
+	// empty string
+	str_split_init(&it, str_null, Lit(","), false);
+	TEST(split_is(&it, (const str[]){ str_null }, 1));
+
+	str_split_init(&it, str_null, Lit(","), true);
+	TEST(split_is(&it, NULL, 0));
+
+	// single delimiter
+	const str s = Lit(",a,,bb,");
+
+	str_split_init(&it, s, Lit(","), false);
+	TEST(split_is(&it, (const str[]){ str_null, Lit("a"), str_null, Lit("bb"), str_null }, 5));
+
+	str_split_init(&it, s, Lit(","), true);
+	TEST(split_is(&it, (const str[]){ Lit("a"), Lit("bb") }, 2));
+
+	str_split_init(&it, Lit("abc"), Lit(","), false);
+	TEST(split_is(&it, (const str[]){ Lit("abc") }, 1));
+
+	// charset
+	const str t = Lit(" x \t y\tz  ");
+
+	str_split_init(&it, t, Lit(" \t"), true);
+	TEST(split_is(&it, (const str[]){ Lit("x"), Lit("y"), Lit("z") }, 3));
+
+	str_split_init(&it, t, Lit(" \t"), false);
+	TEST(str_split_array(&it, NULL, 0) == 8);
+
+	// substring
+	const str u = Lit("a::b::::c::");
+
+	str_split_init_substring(&it, u, Lit("::"), false);
+	TEST(split_is(&it, (const str[]){ Lit("a"), Lit("b"), str_null, Lit("c"), str_null }, 5));
+
+	str_split_init_substring(&it, u, Lit("::"), true);
+	TEST(split_is(&it, (const str[]){ Lit("a"), Lit("b"), Lit("c") }, 3));
+
+	str_split_init_substring(&it, u, str_null, false);
+	TEST(split_is(&it, (const str[]){ u }, 1));
+
+	// partial array
+	str fields[2];
+
+	str_split_init(&it, s, Lit(","), true);
+	TEST(str_split_array(&it, fields, 1) == 2);
+	TEST(str_eq(fields[0], Lit("a")));
+}
+
+TEST_CASE(test_matcher) {
+	const str patterns[] = { Lit("abcd"), Lit("bcd"), Lit("b"), Lit("abcdef"), Lit("xyz"), Lit("bcd"), str_null };
+	str_matcher m;
+	str_match r;
+
+	str_matcher_init(&m, patterns, sizeof(patterns)/sizeof(patterns[0]));
+
+	// leftmost-first
+	const str s = Lit("__abcdef__b__xyzbcd");
+
+	TEST(str_matcher_find(&m, s, 0, str_match_leftmost_first, &r));
+	TEST(r.id == 0 && r.pos == 2 && r.len == 4);
+	TEST(str_matcher_find(&m, s, 3, str_match_leftmost_first, &r));
+	TEST(r.id == 1 && r.pos == 3 && r.len == 3);
+	TEST(str_matcher_find(&m, s, 6, str_match_leftmost_first, &r));
+	TEST(r.id == 2 && r.pos == 10 && r.len == 1);
+	TEST(str_matcher_find(&m, s, 11, str_match_leftmost_first, &r));
+	TEST(r.id == 4 && r.pos == 13 && r.len == 3);
+	TEST(str_matcher_find(&m, s, 16, str_match_leftmost_first, &r));
+	TEST(r.id == 1 && r.pos == 16 && r.len == 3);
+	TEST(!str_matcher_find(&m, s, 19, str_match_leftmost_first, &r));
+	TEST(!str_matcher_find(&m, s, 100, str_match_leftmost_first, &r));
+
+	// leftmost-longest
+	TEST(str_matcher_find(&m, s, 0, str_match_leftmost_longest, &r));
+	TEST(r.id == 3 && r.pos == 2 && r.len == 6);
+	TEST(str_matcher_find(&m, s, 8, str_match_leftmost_longest, &r));
+	TEST(r.id == 2 && r.pos == 10 && r.len == 1);
+
+	// overlapping
+	const str t = Lit("xabcdefx");
+	str_match_iter it = { 0 };
+	const str_match exp[] = {
+		{ 2, 2, 1 },	// b
+		{ 0, 1, 4 },	// abcd
+		{ 1, 2, 3 },	// bcd
+		{ 3, 1, 6 },	// abcdef
+	};
+
+	for(size_t i = 0; i < sizeof(exp)/sizeof(exp[0]); ++i) {
+		TEST(str_matcher_find_overlapping(&m, t, &it, &r));
+		TEST(r.id == exp[i].id && r.pos == exp[i].pos && r.len == exp[i].len);
+	}
+
+	TEST(!str_matcher_find_overlapping(&m, t, &it, &r));
+	TEST(!str_matcher_find_overlapping(&m, t, &it, &r));
+
+	str_matcher_free(&m);
+
+	// no patterns
+	str_matcher_init(&m, NULL, 0);
+
+	TEST(!str_matcher_find(&m, s, 0, str_match_leftmost_first, &r));
+
+	it = (str_match_iter){ 0 };
+
+	TEST(!str_matcher_find_overlapping(&m, s, &it, &r));
+
+	str_matcher_free(&m);
 }
 
 TEST_CASE(test_replace_substring) {
@@ -456,6 +1443,79 @@ TEST_CASE(test_replace_substring) {
 	TEST(str_len(s) == 4 * N);
 	TEST(strlen(str_ptr(s)) == 4 * N);	// just in case
 	TEST(str_span_chars(s, Lit("x")) == 4 * N);
+
+	// in-place
+	str_clone(&s, Lit("aaa\r\nbbb\r\n\r\nccc"));
+
+	const char* const p = str_ptr(s);
+
+	TEST(str_replace_substring(&s, Lit("\r\n"), Lit("\n")) == 3);
+	TEST(str_eq(s, Lit("aaa\nbbb\n\nccc")));
+	TEST(str_ptr(s) == p);
+	TEST(strlen(str_ptr(s)) == str_len(s));
+
+	// replacement pointing into the string itself
+	TEST(str_replace_substring(&s, Lit("a"), str_ref_slice(s, 9, 10)) == 3);
+	TEST(str_eq(s, Lit("ccc\nbbb\n\nccc")));
+}
+
+TEST_CASE(test_replace_map) {
+	const str_replace_pair pairs[] = {
+		{ Lit("&"), Lit("&amp;") },
+		{ Lit("<"), Lit("&lt;") },
+		{ Lit(">"), Lit("&gt;") },
+		{ Lit("<<"), Lit("<") },	// never matches, because "<" comes first
+		{ Lit("\""), str_null },
+	};
+
+	str_replace_table t;
+
+	str_replace_table_init(&t, pairs, sizeof(pairs)/sizeof(pairs[0]));
+
+	// corner cases
+	str_auto s = str_null;
+
+	TEST(str_replace_map(&s, &t) == 0);
+	TEST(str_is_empty(s));
+
+	str_assign(&s, Lit("xyz"));
+
+	TEST(str_replace_map(&s, &t) == 0);
+	TEST(str_is_ref(s));
+	TEST(str_eq(s, Lit("xyz")));
+
+	str_assign(&s, Lit("\"\""));
+
+	TEST(str_replace_map(&s, &t) == 2);
+	TEST(str_is_empty(s));
+
+	// escaping
+	str_assign(&s, Lit("<a href=\"x\">&<<</a>"));
+
+	TEST(str_replace_map(&s, &t) == 9);
+	TEST(str_is_owner(s));
+	TEST(str_eq(s, Lit("&lt;a href=x&gt;&amp;&lt;&lt;&lt;/a&gt;")));
+
+	// more matches than fit on the first pass
+	str_assign(&s, Lit("<>"));
+	str_repeat(&s, 100);
+
+	str_auto r = Lit("&lt;&gt;");
+
+	str_repeat(&r, 100);
+
+	TEST(str_replace_map(&s, &t) == 200);
+	TEST(str_eq(s, r));
+
+	str_replace_table_free(&t);
+
+	// empty table
+	str_replace_table_init(&t, NULL, 0);
+
+	TEST(str_replace_map(&s, &t) == 0);
+	TEST(str_eq(s, r));
+
+	str_replace_table_free(&t);
 }
 
 TEST_CASE(test_replace_chars) {
@@ -656,3 +1716,165 @@ TEST_CASE(test_unique_partition_array) {
 	TEST(str_eq(src[2], str_lit("ccc")));
 	TEST(str_eq(src[3], str_lit("ddd")));
 }
+
+TEST_CASE(test_sso) {
+	str_sso s1 = str_sso_null, s2 = str_sso_null;
+
+	TEST(sizeof(str_sso) == sizeof(str));
+	TEST(str_sso_len(&s1) == 0);
+	TEST(str_sso_eq(&s1, &s2));
+
+	// inline
+	str_sso_clone(&s1, Lit("0123456789abcd"));
+
+	TEST(str_sso_is_small(&s1));
+	TEST(str_eq(str_sso_ref(&s1), Lit("0123456789abcd")));
+	TEST(strlen(str_sso_ptr(&s1)) == str_sso_len(&s1));
+
+	// heap
+	str_sso_clone(&s2, Lit("0123456789abcde"));
+
+	TEST(!str_sso_is_small(&s2));
+	TEST(str_eq(str_sso_ref(&s2), Lit("0123456789abcde")));
+	TEST(strlen(str_sso_ptr(&s2)) == str_sso_len(&s2));
+	TEST(!str_sso_eq(&s1, &s2));
+	TEST(str_sso_cmp(&s1, &s2) < 0);
+
+	// self-assignment
+	str_sso_clone(&s2, str_sso_ref(&s2));
+
+	TEST(str_eq(str_sso_ref(&s2), Lit("0123456789abcde")));
+
+	str_sso_clone(&s2, str_sso_ref(&s1));
+
+	TEST(str_sso_is_small(&s2));
+	TEST(str_sso_eq(&s1, &s2));
+	TEST(str_sso_cmp(&s1, &s2) == 0);
+
+	str_sso_clear(&s1);
+	str_sso_clear(&s2);
+
+	// sorting
+	str_sso array[4] = { 0 };
+
+	str_sso_clone(&array[0], Lit("xxx"));
+	str_sso_clone(&array[1], Lit("xxxxxxxxxxxxxxxxxxxx"));
+	str_sso_clone(&array[2], Lit("aaa"));
+	str_sso_clone(&array[3], Lit("bbbbbbbbbbbbbbbbbbbb"));
+
+	str_sso_sort_array(str_sso_order_asc, array, 4);
+
+	TEST(str_eq(str_sso_ref(&array[0]), Lit("aaa")));
+	TEST(str_eq(str_sso_ref(&array[1]), Lit("bbbbbbbbbbbbbbbbbbbb")));
+	TEST(str_eq(str_sso_ref(&array[2]), Lit("xxx")));
+	TEST(str_eq(str_sso_ref(&array[3]), Lit("xxxxxxxxxxxxxxxxxxxx")));
+
+	str_sso_sort_array(str_sso_order_desc, array, 4);
+
+	TEST(str_eq(str_sso_ref(&array[0]), Lit("xxxxxxxxxxxxxxxxxxxx")));
+	TEST(str_eq(str_sso_ref(&array[3]), Lit("aaa")));
+
+	for(int i = 0; i < 4; ++i)
+		str_sso_free(array[i]);
+}
+
+#ifdef STR_STATS
+TEST_CASE(test_stats) {
+	str_stats_reset();
+
+	str s = str_null;
+
+	str_clone(&s, Lit("xxx"));
+	str_concat(&s, s, Lit("yyy"), s);
+
+	TEST(str_eq(s, Lit("xxxyyyxxx")));
+	TEST(str_replace_substring(&s, Lit("y"), Lit("zz")) == 3);
+
+	str_clear(&s);
+
+	str_stats st;
+
+	str_stats_snapshot(&st);
+
+	const str_stats_counters* c = &st.fn[str_stats_str_clone];
+
+	TEST(c->calls == 1);
+	TEST(c->bytes_in == 3 && c->bytes_out == 3);
+	TEST(c->allocs == 1 && c->bytes_allocated == 4);
+
+	c = &st.fn[str_stats_str_concat_array];
+
+	TEST(c->calls == 1);
+	TEST(c->bytes_in == 9 && c->bytes_out == 9);
+	TEST(c->allocs == 1);
+
+	// nested calls are accounted to the outermost one
+	c = &st.fn[str_stats_str_replace_substring];
+
+	TEST(c->calls == 1);
+	TEST(c->bytes_in == 9 && c->bytes_out == 12);
+	TEST(c->allocs == 1 && c->reallocs == 0);
+	TEST(st.fn[str_stats_str_builder_append_mem].calls == 0);
+
+	// allocation sizes
+	TEST(st.sizes[str_stats_cat_clone].max_request == 4);
+	TEST(st.sizes[str_stats_cat_clone].hist[2] == 1);
+	TEST(st.sizes[str_stats_cat_concat].max_request == 10);
+	TEST(st.sizes[str_stats_cat_replace].max_request > 0);
+	TEST(st.sizes[str_stats_cat_join].max_request == 0);
+
+	// live memory
+	const int64_t live = str_stats_live_bytes();
+
+	str_clone(&s, Lit("0123456789"));
+
+	TEST(str_stats_live_bytes() == live + 11);
+	TEST(str_stats_peak_bytes() >= live + 11);
+
+	str_replace_substring(&s, Lit("5"), Lit("55555"));
+
+	TEST(str_stats_live_bytes() == live + 15);
+
+	str_clear(&s);
+
+	TEST(str_stats_live_bytes() == live);
+
+	// heap blocks are accounted for by their owner, whatever the allocator in effect
+	str_arena a;
+
+	str_arena_init(&a, 0);
+	str_clone(&s, Lit("0123456789"));
+	str_set_thread_allocator(&a.allocator);
+	str_clear(&s);
+	str_set_thread_allocator(NULL);
+
+	TEST(str_stats_live_bytes() == live);
+
+	str_arena_free(&a);
+	str_stats_reset_peak();
+
+	TEST(str_stats_peak_bytes() == live);
+
+	// merge
+	str_stats total = { 0 };
+
+	str_stats_merge(&total, &st);
+	str_stats_merge(&total, &st);
+
+	TEST(total.fn[str_stats_str_clone].calls == 2);
+
+	// dump
+	FILE* const stream = fopen("/dev/null", "w");
+
+	TEST(stream);
+	TEST(str_stats_dump(stream, &total) == 0);
+
+	fclose(stream);
+
+	// reset
+	str_stats_reset();
+	str_stats_snapshot(&st);
+
+	TEST(st.fn[str_stats_str_clone].calls == 0);
+}
+#endif
@@ -540,6 +540,29 @@ TEST_CASE(test_count_codepoints) {
 
 		TESTF(n == p->n, "[%zu]: invalid number: %zu instead of %zu", p - test_cases, n, p->n);
 	}
+
+	// the same sequences inside long strings
+	str_builder sb = str_builder_null;
+	const str tail = Lit(" trailing text, long enough to fill the last block");
+
+	for(const test_case* p = test_cases; p < end; ++p) {
+		for(size_t k = 20; k < 100; ++k) {
+			sb.len = 0;
+
+			for(size_t i = 0; i < k; ++i)
+				str_builder_append_str(&sb, (i % 3 == 0) ? Lit(u8"ж€") : Lit("xy"));
+
+			str_builder_append_str(&sb, p->s);
+			str_builder_append_str(&sb, tail);
+
+			const size_t n = str_count_codepoints(str_ref_mem(sb.ptr, sb.len));
+			const size_t exp = 2 * k + p->n + str_len(tail);
+
+			TESTF(n == exp, "[%zu] at %zu: invalid number: %zu instead of %zu", p - test_cases, k, n, exp);
+		}
+	}
+
+	str_builder_free(&sb);
 }
 
 // encoder test -----------------------------------------------------------------------------------
@@ -593,3 +616,149 @@ TEST_CASE(test_encode_codepoint) {
 			TESTF(memcmp(buff, p->seq, n) == 0, "[%zu] sequence mismatch", end - p);
 	}
 }
+
+// decode the whole string in chunks of `chunk` codepoints
+static
+size_t decode_array(const str s, const bool replace, const size_t chunk,
+					uint32_t* const cps, size_t* const offsets, size_t* const error) {
+	str_utf8_decoder dec;
+	size_t n = 0, k;
+
+	str_utf8_decoder_init(&dec, s, replace);
+
+	while((k = str_decode_utf8_array(&dec, cps + n, offsets + n, chunk)) > 0)
+		n += k;
+
+	*error = dec.error;
+	return n;
+}
+
+TEST_CASE(test_decode_utf8_array) {
+	const str s = Lit("ASCII text, longer than one block; "
+					  u8"кириллица, тоже длиннее блока; "
+					  u8"€ 😀 "
+					  "bad: \xC0\x80 \xE0\xA0 \xF0\x90\x80\x80 end");
+
+	const size_t err = str_span_valid_utf8(s);
+
+	TEST(err < str_len(s));
+
+	// expected results
+	uint32_t exp_cps[200];
+	size_t exp_offsets[200], n = 0;
+
+	for(const char* p = str_ptr(s); p < str_end(s); ++n) {
+		const str_decode_result r = str_decode_utf8(p, str_end(s) - p);
+
+		exp_offsets[n] = p - str_ptr(s);
+
+		if(r.status == STR_UTF8_OK) {
+			exp_cps[n] = r.codepoint;
+			p += r.num_bytes;
+		} else {
+			exp_cps[n] = 0xFFFD;
+			p += (r.status == STR_UTF8_INCOMPLETE || r.num_bytes == 1) ? r.num_bytes : (r.num_bytes - 1);
+		}
+	}
+
+	TEST(n == str_count_codepoints(s));
+
+	for(size_t chunk = 1; chunk <= 40; ++chunk) {
+		uint32_t cps[200];
+		size_t offsets[200], error;
+
+		// replacement mode
+		size_t k = decode_array(s, true, chunk, cps, offsets, &error);
+
+		TESTF(k == n, "[%zu] replace: %zu codepoints instead of %zu", chunk, k, n);
+		TESTF(memcmp(cps, exp_cps, n * sizeof(cps[0])) == 0, "[%zu] replace: codepoint mismatch", chunk);
+		TESTF(memcmp(offsets, exp_offsets, n * sizeof(offsets[0])) == 0, "[%zu] replace: offset mismatch", chunk);
+		TESTF(error == err, "[%zu] replace: error at %zu instead of %zu", chunk, error, err);
+
+		// strict mode
+		k = decode_array(s, false, chunk, cps, offsets, &error);
+
+		TESTF(error == err, "[%zu] strict: error at %zu instead of %zu", chunk, error, err);
+		TESTF(offsets[k - 1] < err && exp_offsets[k] == err, "[%zu] strict: stopped at %zu", chunk, k);
+		TESTF(memcmp(cps, exp_cps, k * sizeof(cps[0])) == 0, "[%zu] strict: codepoint mismatch", chunk);
+	}
+
+	// valid string, without offsets
+	str_utf8_decoder dec;
+	uint32_t cps[100];
+
+	str_utf8_decoder_init(&dec, Lit(u8"a€😀"), false);
+
+	TEST(str_decode_utf8_array(&dec, cps, NULL, 100) == 3);
+	TEST(cps[0] == 'a' && cps[1] == 0x20AC && cps[2] == 0x1F600);
+	TEST(str_decode_utf8_array(&dec, cps, NULL, 100) == 0);
+	TEST(dec.error == 8);
+
+	// empty string
+	str_utf8_decoder_init(&dec, str_null, true);
+
+	TEST(str_decode_utf8_array(&dec, cps, NULL, 100) == 0);
+	TEST(dec.error == 0);
+}
+
+TEST_CASE(test_transcode) {
+	// "aж€😀" in all encodings
+	const str u8 = Lit(u8"aж€😀");
+	const str u16le = Lit("a\0\x36\x04\xAC\x20\x3D\xD8\x00\xDE");
+	const str u16be = Lit("\0a\x04\x36\x20\xAC\xD8\x3D\xDE\x00");
+	const str u32le = Lit("a\0\0\0\x36\x04\0\0\xAC\x20\0\0\x00\xF6\x01\0");
+	const str u32be = Lit("\0\0\0a\0\0\x04\x36\0\0\x20\xAC\0\x01\xF6\x00");
+
+	str_auto s = str_null;
+
+	TEST(str_utf8_to_utf16(&s, u8, false) == str_len(u8) && str_eq(s, u16le));
+	TEST(str_utf8_to_utf16(&s, u8, true) == str_len(u8) && str_eq(s, u16be));
+	TEST(str_utf8_to_utf32(&s, u8, false) == str_len(u8) && str_eq(s, u32le));
+	TEST(str_utf8_to_utf32(&s, u8, true) == str_len(u8) && str_eq(s, u32be));
+
+	TEST(str_utf16_to_utf8(&s, u16le, false) == str_len(u16le) && str_eq(s, u8));
+	TEST(str_utf16_to_utf8(&s, u16be, true) == str_len(u16be) && str_eq(s, u8));
+	TEST(str_utf32_to_utf8(&s, u32le, false) == str_len(u32le) && str_eq(s, u8));
+	TEST(str_utf32_to_utf8(&s, u32be, true) == str_len(u32be) && str_eq(s, u8));
+
+	// empty string
+	TEST(str_utf8_to_utf16(&s, str_null, false) == 0 && str_is_empty(s));
+	TEST(str_utf16_to_utf8(&s, str_null, false) == 0 && str_is_empty(s));
+
+	// long strings, round trip
+	str_builder sb = str_builder_null;
+	str_auto t = str_null;
+
+	for(int i = 0; i < 50; ++i)
+		str_builder_append_str(&sb, (i % 5 == 0) ? Lit(u8"€😀 ") : (i % 3 == 0) ? Lit(u8"жёлтый ") : Lit("text "));
+
+	const str src = str_ref_mem(sb.ptr, sb.len);
+
+	for(int be = 0; be < 2; ++be) {
+		TEST(str_utf8_to_utf16(&s, src, be) == str_len(src));
+		TEST(str_len(s) == 2 * (str_count_codepoints(src) + 10));	// 10 surrogate pairs
+		TEST(str_utf16_to_utf8(&t, s, be) == str_len(s));
+		TEST(str_eq(t, src));
+
+		TEST(str_utf8_to_utf32(&s, src, be) == str_len(src));
+		TEST(str_len(s) == 4 * str_count_codepoints(src));
+		TEST(str_utf32_to_utf8(&t, s, be) == str_len(s));
+		TEST(str_eq(t, src));
+	}
+
+	str_builder_free(&sb);
+
+	// invalid input leaves the destination unchanged
+	str_assign(&s, Lit("xyz"));
+
+	TEST(str_utf8_to_utf16(&s, Lit("ab\xC0\x80"), false) == 2);
+	TEST(str_utf8_to_utf32(&s, Lit("ab\xE2\x82"), false) == 2);
+	TEST(str_utf16_to_utf8(&s, Lit("a\0\x00\xDC"), false) == 2);			// lone low surrogate
+	TEST(str_utf16_to_utf8(&s, Lit("a\0\x00\xD8" "b\0"), false) == 2);		// unpaired high surrogate
+	TEST(str_utf16_to_utf8(&s, Lit("a\0\x00\xD8"), false) == 2);			// truncated pair
+	TEST(str_utf16_to_utf8(&s, Lit("a\0b"), false) == 2);					// odd length
+	TEST(str_utf32_to_utf8(&s, Lit("a\0\0\0\x00\xD8\0\0"), false) == 4);	// surrogate
+	TEST(str_utf32_to_utf8(&s, Lit("\0\x11\0\0"), true) == 0);				// out of range
+	TEST(str_utf32_to_utf8(&s, Lit("a\0\0\0b\0"), false) == 4);				// incomplete codepoint
+	TEST(str_eq(s, Lit("xyz")));
+}
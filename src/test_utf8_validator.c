@@ -186,6 +186,17 @@ const char* str_to_hex(const str src) {
 	return buff;
 }
 
+// number of U+FFFD in the string
+static
+size_t count_repl(const str s) {
+	size_t n = 0;
+
+	for(const char* p = str_ptr(s); p + sizeof(REPL) - 1 <= str_end(s); ++p)
+		n += (memcmp(p, REPL, sizeof(REPL) - 1) == 0);
+
+	return n;
+}
+
 TEST_CASE(test_utf8_validator) {
 	const test_case* const end = tests + sizeof(tests)/sizeof(tests[0]);
 	str_auto s = str_null;
@@ -201,6 +212,19 @@ TEST_CASE(test_utf8_validator) {
 			TESTF(false, "[%zu] failed", p - tests);
 		}
 	}
+
+	// the same sequences inside long strings
+	str_auto exp = str_null;
+	const str head = Lit("\xE2\x82\xAC some text before the sequence, long enough to fill a block ");
+	const str tail = Lit(" some text after the sequence, also long enough to fill a block");
+
+	for(const test_case* p = tests; p < end; ++p) {
+		str_concat(&s, head, head, p->src, tail, p->src);
+		str_concat(&exp, head, head, p->res, tail, p->res);
+
+		TESTF(str_to_valid_utf8(&s) == 2 * count_repl(p->res), "[%zu] long: invalid count", p - tests);
+		TESTF(str_eq(s, exp), "[%zu] long: failed", p - tests);
+	}
 }
 
 TEST_CASE(test_utf8_real_text) {
@@ -208,5 +232,59 @@ TEST_CASE(test_utf8_real_text) {
 	const int err = str_read_all_file(&s, "test-data/unicode-test.txt");
 
 	TESTF(err == 0, "str_read_all_file: %s", strerror(err));
+	TEST(str_is_valid_utf8(s));
 	TEST(str_to_valid_utf8(&s) == 0);
 }
+
+// length of the valid prefix, using the decoder
+static
+size_t valid_prefix(const str s) {
+	const char* const p = str_ptr(s);
+	const size_t len = str_len(s);
+	size_t i = 0;
+
+	while(i < len) {
+		const str_decode_result r = str_decode_utf8(p + i, len - i);
+
+		if(r.status != STR_UTF8_OK)
+			break;
+
+		i += r.num_bytes;
+	}
+
+	return i;
+}
+
+TEST_CASE(test_span_valid_utf8) {
+	const test_case* const end = tests + sizeof(tests)/sizeof(tests[0]);
+	str_builder sb = str_builder_null;
+
+	TEST(str_span_valid_utf8(str_null) == 0);
+	TEST(str_is_valid_utf8(str_null));
+
+	for(const test_case* p = tests; p < end; ++p) {
+		const size_t n = valid_prefix(p->src);
+
+		TESTF(str_span_valid_utf8(p->src) == n, "[%zu] failed", p - tests);
+		TESTF(str_is_valid_utf8(p->src) == str_eq(p->src, p->res), "[%zu] failed", p - tests);
+
+		// the same sequence at every position around the block boundaries
+		for(size_t k = 55; k < 135; ++k) {
+			sb.len = 0;
+
+			for(size_t i = 0; i < k; ++i)
+				str_builder_append_str(&sb, (i % 7 == 0) ? Lit("\xE2\x82\xAC") : Lit("x"));
+
+			const size_t off = sb.len;
+
+			str_builder_append_str(&sb, p->src);
+			str_builder_append_str(&sb, Lit(" trailing text, long enough to fill the last block"));
+
+			const size_t exp = (n < str_len(p->src)) ? off + n : sb.len;
+
+			TESTF(str_span_valid_utf8(str_ref_mem(sb.ptr, sb.len)) == exp, "[%zu] at %zu", p - tests, k);
+		}
+	}
+
+	str_builder_free(&sb);
+}
@@ -52,14 +52,17 @@ typedef struct {
 #define str_null ((str){ 0 })
 
 // helper macros (not for general use)
-#define str_ref_prop(n)			((n) << 1)
+#define str_ref_prop(n)			((n) << 3)
 #define str_owner_prop(n)		(str_ref_prop(n) | 1)
-#define str_mask_owner(prop)	((prop) & ~(size_t)1)
+#define str_shared_prop(n)		(str_ref_prop(n) | 2)
+#define str_growable_prop(n)	(str_ref_prop(n) | 3)
+#define str_acquired_prop(n)	(str_ref_prop(n) | 4)
+#define str_mask_owner(prop)	((prop) & ~(size_t)7)
 
 // string properties ------------------------------------------------------------------------------
 // length of the string
 static inline
-size_t str_len(const str s) { return s.prop >> 1; }
+size_t str_len(const str s) { return s.prop >> 3; }
 
 // pointer to the string
 static inline
@@ -75,7 +78,11 @@ bool str_is_empty(const str s) { return str_len(s) == 0; }
 
 // test if the string is allocated on the heap
 static inline
-bool str_is_owner(const str s) { return (s.prop & 1) != 0; }
+bool str_is_owner(const str s) { return (s.prop & 7) != 0; }
+
+// test if the string is shared
+static inline
+bool str_is_shared(const str s) { return (s.prop & 7) == 2; }
 
 // test if the string is a reference
 static inline
@@ -84,12 +91,41 @@ bool str_is_ref(const str s) { return !str_is_owner(s); }
 // hash the string
 uint64_t str_hash(const str s);
 
+// memory allocator -------------------------------------------------------------------------------
+typedef struct {
+	void* (*alloc)(void* ctx, size_t n);
+	void* (*realloc)(void* ctx, void* p, size_t n);
+	void (*free)(void* ctx, void* p);
+	void (*failure)(void* ctx);	// optional
+	void* ctx;
+} str_allocator;
+
+// set process-wide allocator, or restore the default one if `a` is NULL
+void str_set_allocator(const str_allocator* const a);
+
+// set allocator for the calling thread, or revert to the process-wide one if `a` is NULL
+void str_set_thread_allocator(const str_allocator* const a);
+
+// get the allocator in effect for the calling thread (NULL for the default one)
+const str_allocator* str_get_allocator(void);
+
+// allocator caching blocks of up to 256 bytes in per-thread free lists
+extern const str_allocator str_pool_allocator;
+
+// set the maximum number of free blocks the calling thread keeps for the size class of `block_size`
+void str_pool_set_limit(const size_t block_size, const size_t max_free);
+
+// release all free blocks cached by the calling thread
+void str_pool_trim(void);
+
 // string memory control --------------------------------------------------------------------------
 // free memory allocated for the string
 static inline
 void str_free(const str s) {
+	extern void str_free_impl(const str);
+
 	if(str_is_owner(s))
-		free((void*)s.ptr);
+		str_free_impl(s);
 }
 
 // clear string
@@ -150,11 +186,11 @@ str str_acquire(str* const ps) {
 	return t;
 }
 
-// take ownership of the given memory area
+// take ownership of the given memory area allocated with malloc
 static inline
 str str_acquire_mem(const char* const s, const size_t n) {
 	if(s && n > 0)
-		return (str){ s, str_owner_prop(n) };
+		return (str){ s, str_acquired_prop(n) };
 
 	free((void*)s);
 	return str_null;
@@ -212,6 +248,9 @@ bool str_sprintf(str* const dest, const char* const fmt, ...) __attribute__((for
 // allocate and assign a copy of the given string
 void str_clone(str* const dest, const str s);
 
+// assign a shared copy of the given string
+void str_share(str* const dest, const str s);
+
 // concatenate array of strings
 void str_concat_array(str* const dest, const str* array, const size_t count);
 
@@ -233,28 +272,304 @@ void str_join_array(str* const dest, const str sep, const str* array, size_t cou
 // repeat the given string `n` times
 void str_repeat(str* const s, size_t n);
 
+// string builder ---------------------------------------------------------------------------------
+typedef struct {
+	char* ptr;
+	size_t len, cap;
+} str_builder;
+
+// empty builder
+#define str_builder_null ((str_builder){ 0 })
+
+// release memory held by the builder
+void str_builder_free(str_builder* const sb);
+
+// make sure the builder has space for at least `n` more bytes
+void str_builder_reserve(str_builder* const sb, const size_t n);
+
+// append the given range of chars
+void str_builder_append_mem(str_builder* const sb, const char* const s, const size_t n);
+
+// append string
+static inline
+void str_builder_append_str(str_builder* const sb, const str s) {
+	str_builder_append_mem(sb, str_ptr(s), str_len(s));
+}
+
+// append one byte
+static inline
+void str_builder_append_char(str_builder* const sb, const char c) {
+	if(sb->cap - sb->len < 2)
+		str_builder_reserve(sb, 1);
+
+	sb->ptr[sb->len++] = c;
+}
+
+// append UTF-8 encoded codepoint, returning the number of bytes appended
+size_t str_builder_append_codepoint(str_builder* const sb, const uint32_t cp);
+
+// move the content of the builder to the destination string, leaving the builder empty
+void str_builder_finish(str* const dest, str_builder* const sb);
+
+// arena ------------------------------------------------------------------------------------------
+typedef struct {
+	struct str_arena_chunk *head, *first, *spare;	// chunk lists
+	char *ptr, *end;	// free space in the current chunk
+	char* last;			// last allocation
+	size_t chunk_size;
+	const str_allocator* parent;	// allocator for chunks
+	str_allocator allocator;		// the arena as an allocator
+} str_arena;
+
+// initialise arena with the given chunk size (0 for default)
+void str_arena_init(str_arena* const arena, const size_t chunk_size);
+
+// make all memory allocated from the arena available for reuse
+void str_arena_reset(str_arena* const arena);
+
+// release all memory held by the arena
+void str_arena_free(str_arena* const arena);
+
+// arena versions of string operations, all producing references to the arena memory
+void str_arena_clone(str_arena* const arena, str* const dest, const str s);
+void str_arena_concat_array(str_arena* const arena, str* const dest, const str* array, const size_t count);
+void str_arena_join_array(str_arena* const arena, str* const dest, const str sep, const str* array, size_t count);
+
+bool str_arena_sprintf(str_arena* const arena, str* const dest, const char* const fmt, ...)
+	__attribute__((format(printf,3,4)));
+
+size_t str_arena_replace_substring(str_arena* const arena, str* const dest, const str patt, const str repl);
+size_t str_arena_replace_chars(str_arena* const arena, str* const dest, const str charset, const str repl);
+size_t str_arena_replace_char_spans(str_arena* const arena, str* const dest, const str charset, const str repl);
+
+// concatenate string arguments in the arena
+#define str_arena_concat(arena, dest, ...) ({	\
+	const str args[] = { __VA_ARGS__ };	\
+	str_arena_concat_array((arena), (dest), args, sizeof(args)/sizeof(args[0]));	\
+})
+
+// join string arguments around a separator in the arena
+#define str_arena_join(arena, dest, sep, ...) ({	\
+	const str args[] = { __VA_ARGS__ };	\
+	str_arena_join_array((arena), (dest), (sep), args, sizeof(args)/sizeof(args[0]));	\
+})
+
+// character set ----------------------------------------------------------------------------------
+// precompiled set of bytes (read-only after initialisation)
+typedef struct {
+	uint8_t bits[256 / 8];	// one bit per byte value
+	uint8_t lo[16], hi[16];	// lookup tables for vectorised scanning
+	uint8_t n, chars[3];	// the bytes of a set of up to 3 bytes, otherwise n is 0
+} str_charset;
+
+// compile set of bytes from string `chars`
+void str_charset_init(str_charset* const cs, const str chars);
+
+// test if byte `c` is in the set
+static inline
+bool str_charset_has(const str_charset* const cs, const char c) {
+	return cs->bits[(uint8_t)c / 8] & (1 << ((uint8_t)c % 8));
+}
+
+// substring finder -------------------------------------------------------------------------------
+// precompiled substring searcher (read-only after initialisation, refers to the needle)
+typedef struct {
+	str needle;						// the needle
+	size_t rare[2];					// offsets of two rare bytes of the needle
+	size_t split, period, mem;		// Two-Way parameters
+	size_t rsplit, rperiod, rmem;	// same for the reversed needle
+} str_finder;
+
+// compile finder for the given needle
+void str_finder_init(str_finder* const f, const str needle);
+
+// find the first occurrence of the needle in `s`, and return its position, or str_len(s) if not found
+size_t str_finder_first(const str_finder* const f, const str s);
+
+// same as above, but starting from position `pos`
+size_t str_finder_next(const str_finder* const f, const str s, const size_t pos);
+
+// find the last occurrence of the needle in `s`, and return its position, or str_len(s) if not found
+size_t str_finder_last(const str_finder* const f, const str s);
+
+// multi-pattern matcher --------------------------------------------------------------------------
+// precompiled Aho-Corasick automaton (read-only after initialisation)
+typedef struct {
+	uint32_t* delta;					// transition table
+	struct str_matcher_state* states;	// state properties
+	size_t num_states, max_len;
+	unsigned shift;						// log2 of the transition table row size
+	uint8_t classes[256];				// byte classes
+	str_charset start;					// bytes that can start a match
+} str_matcher;
+
+// match
+typedef struct {
+	size_t id;	// index of the pattern
+	size_t pos;	// offset of the match
+	size_t len;	// length of the match
+} str_match;
+
+// match semantics for the leftmost search
+typedef enum {
+	str_match_leftmost_first,	// on the same offset, the pattern listed first wins
+	str_match_leftmost_longest	// on the same offset, the longest pattern wins
+} str_match_kind;
+
+// iterator for the overlapping search (zero-initialised before use)
+typedef struct {
+	size_t pos;
+	uint32_t state, link;
+} str_match_iter;
+
+// compile matcher for the given array of patterns
+void str_matcher_init(str_matcher* const m, const str* const patterns, const size_t count);
+
+// release memory held by the matcher
+void str_matcher_free(str_matcher* const m);
+
+// find the leftmost match at or after position `pos`, return false if not found
+bool str_matcher_find(const str_matcher* const m, const str s, const size_t pos,
+					  const str_match_kind kind, str_match* const match);
+
+// find the next match, including the overlapping ones, return false when there are no more matches
+bool str_matcher_find_overlapping(const str_matcher* const m, const str s, str_match_iter* const it,
+								  str_match* const match);
+
 // search -----------------------------------------------------------------------------------------
 // span the initial part of the string `s` as long as the characters from `s` occur
 // in string `charset`, and return the number of characters spanned
 size_t str_span_chars(const str s, const str charset);
+size_t str_span_chars_cs(const str s, const str_charset* const cs);
 
 // span the initial part of the string `s` as long as the characters from `s` do not occur
 // in string `charset`, and return the number of characters spanned
 size_t str_span_nonmatching_chars(const str s, const str charset);
+size_t str_span_nonmatching_chars_cs(const str s, const str_charset* const cs);
 
 // span the initial part of the string `s` until an instance of `substr` is found,
 // and return the number of characters spanned
 size_t str_span_until_substring(const str s, const str substr);
 
+// span the final part of the string `s` as long as the characters from `s` occur
+// in string `charset`, and return the number of characters spanned
+size_t str_span_trailing_chars(const str s, const str charset);
+size_t str_span_trailing_chars_cs(const str s, const str_charset* const cs);
+
+// span the final part of the string `s` as long as the characters from `s` do not occur
+// in string `charset`, and return the number of characters spanned
+size_t str_span_trailing_nonmatching_chars(const str s, const str charset);
+size_t str_span_trailing_nonmatching_chars_cs(const str s, const str_charset* const cs);
+
+// span the initial part of the string `s` until the last instance of `substr`,
+// and return the number of characters spanned
+size_t str_span_until_last_substring(const str s, const str substr);
+
+// find all non-overlapping occurrences of `substr` in `s`, store the offsets of up to `n` of them
+// in `pos`, and return the total number of occurrences
+size_t str_find_all_substring(const str s, const str substr, size_t* const pos, const size_t n);
+size_t str_finder_find_all(const str_finder* const f, const str s, size_t* const pos, const size_t n);
+
+// find all bytes of `s` that occur in `charset`, store the offsets of up to `n` of them in `pos`,
+// and return the total number of such bytes
+size_t str_find_all_chars(const str s, const str charset, size_t* const pos, const size_t n);
+size_t str_find_all_chars_cs(const str s, const str_charset* const cs, size_t* const pos, const size_t n);
+
+// count occurrences of byte `c` in `s`
+size_t str_count_byte(const str s, const char c);
+
+// count bytes of `s` that occur in `charset`
+size_t str_count_chars(const str s, const str charset);
+size_t str_count_chars_cs(const str s, const str_charset* const cs);
+
+// count non-overlapping occurrences of `substr` in `s`
+size_t str_count_substring(const str s, const str substr);
+
+// line index -------------------------------------------------------------------------------------
+typedef struct {
+	void* starts;			// offsets of the line starts (uint32_t, or uint64_t if `wide`)
+	size_t num_starts, cap;	// number of stored offsets, and capacity
+	size_t num_breaks;		// number of newlines in the indexed text
+	size_t len, last;		// length of the indexed text, and the start of its last line
+	unsigned shift;			// only the start of every (1 << shift)-th line is stored
+	bool wide;
+} str_line_index;
+
+// initialise index storing the start of every (1 << shift)-th line (0 for every line)
+void str_line_index_init(str_line_index* const idx, const unsigned shift);
+
+// release memory held by the index
+void str_line_index_free(str_line_index* const idx);
+
+// index the text of `s` beyond the part already indexed (that part must not change)
+void str_line_index_update(str_line_index* const idx, const str s);
+
+// number of lines in the indexed text
+size_t str_line_index_count(const str_line_index* const idx);
+
+// get the `n`-th line (without the newline) as a reference to `s`, or str_null if there is no such line
+str str_line_index_get(const str_line_index* const idx, const str s, const size_t n);
+
+// split ------------------------------------------------------------------------------------------
+// iterator over the fields of a string
+typedef struct {
+	const char* ptr;	// remaining part of the string, NULL after the last field
+	const char* end;
+
+	union {
+		str_charset cs;		// delimiter bytes
+		str_finder finder;	// delimiter substring
+	};
+
+	bool substring, skip_empty;
+} str_split_iter;
+
+// initialise iterator over the fields of `s` delimited by any byte from `charset`,
+// optionally skipping the empty fields
+void str_split_init(str_split_iter* const it, const str s, const str charset, const bool skip_empty);
+
+// initialise iterator over the fields of `s` delimited by `delim`, optionally skipping the empty fields
+void str_split_init_substring(str_split_iter* const it, const str s, const str delim, const bool skip_empty);
+
+// get the next field as a reference to the source string, return false if there are no more fields
+bool str_split_next(str_split_iter* const it, str* const field);
+
+// store up to `n` of the remaining fields in `array` (without advancing the iterator),
+// and return the total number of the remaining fields
+size_t str_split_array(const str_split_iter* const it, str* const array, const size_t n);
+
 // search & replace -------------------------------------------------------------------------------
 // replace every occurrence of `patt` with `repl`
 size_t str_replace_substring(str* const dest, const str patt, const str repl);
 
+// pattern and its replacement
+typedef struct {
+	str patt, repl;
+} str_replace_pair;
+
+// compiled table of replacements (read-only after initialisation)
+typedef struct {
+	str_matcher matcher;
+	const str* repl;
+	size_t count, size;
+} str_replace_table;
+
+// compile table of replacements from the given array of pairs
+void str_replace_table_init(str_replace_table* const t, const str_replace_pair* const pairs, const size_t count);
+
+// release memory held by the table
+void str_replace_table_free(str_replace_table* const t);
+
+// replace every occurrence of any pattern from the table with its replacement
+size_t str_replace_map(str* const dest, const str_replace_table* const t);
+
 // replace every occurrence of any byte from `charset` with `repl`
 size_t str_replace_chars(str* const dest, const str charset, const str repl);
+size_t str_replace_chars_cs(str* const dest, const str_charset* const cs, const str repl);
 
 // replace every span of bytes from `charset` with `repl`
 size_t str_replace_char_spans(str* const dest, const str charset, const str repl);
+size_t str_replace_char_spans_cs(str* const dest, const str_charset* const cs, const str repl);
 
 // Unicode ----------------------------------------------------------------------------------------
 // result bitfield
@@ -290,6 +605,14 @@ str_decode_result str_decode_utf8(const char* src, size_t len) {
 	return str_decode_utf8_impl((const uint8_t*)src, len);
 }
 
+// span the initial part of the string `s` that is valid UTF-8, and return the number
+// of bytes spanned (the offset of the first invalid sequence)
+size_t str_span_valid_utf8(const str s);
+
+// test if the string is valid UTF-8
+static inline
+bool str_is_valid_utf8(const str s) { return str_span_valid_utf8(s) == str_len(s); }
+
 // count number of codepoints in a string
 size_t str_count_codepoints(const str s);
 
@@ -299,6 +622,37 @@ size_t str_to_valid_utf8(str* const dest);
 // convert codepoint to UTF-8 sequence
 size_t str_encode_codepoint(char* const p, uint32_t cp);
 
+// bulk UTF-8 decoder
+typedef struct {
+	const char *base, *ptr, *end;	// source string, and the remaining part of it
+	size_t error;					// offset of the first invalid sequence, or the string length
+	bool replace;					// decode invalid sequences as U+FFFD, instead of stopping
+} str_utf8_decoder;
+
+// initialise decoder of the string `s`
+void str_utf8_decoder_init(str_utf8_decoder* const dec, const str s, const bool replace);
+
+// decode up to `n` codepoints into `cps`, and optionally store the byte offset of each codepoint
+// in `offsets` (unless NULL); returns the number of codepoints stored, 0 at the end of the string,
+// or at the first invalid sequence if not in replacement mode
+size_t str_decode_utf8_array(str_utf8_decoder* const dec, uint32_t* const cps, size_t* const offsets, const size_t n);
+
+// transcoding: each function converts the string `s` and assigns the result to `dest`, returning
+// `str_len(s)` on success, or the byte offset of the first invalid sequence, in which case `dest`
+// is left unchanged; UTF-16 and UTF-32 strings are in little-endian byte order, unless `big_endian`
+
+// convert UTF-8 string to UTF-16
+size_t str_utf8_to_utf16(str* const dest, const str s, const bool big_endian);
+
+// convert UTF-16 string to UTF-8
+size_t str_utf16_to_utf8(str* const dest, const str s, const bool big_endian);
+
+// convert UTF-8 string to UTF-32
+size_t str_utf8_to_utf32(str* const dest, const str s, const bool big_endian);
+
+// convert UTF-32 string to UTF-8
+size_t str_utf32_to_utf8(str* const dest, const str s, const bool big_endian);
+
 // I/O --------------------------------------------------------------------------------------------
 // write array of strings to the file stream
 int str_concat_array_to_stream(FILE* const stream, const str* src, const size_t count);
@@ -344,6 +698,259 @@ size_t str_partition_array(bool (*pred)(const str), str* const array, const size
 // unique partitioning
 size_t str_unique_partition_array(str* const array, const size_t count);
 
+// small strings ----------------------------------------------------------------------------------
+// string object that keeps short strings inline, and longer ones on the heap
+typedef union {
+	str heap;
+	struct {
+		char data[sizeof(str) - 1];
+		uint8_t tag;	// 0x80 | length
+	} small;
+} str_sso;
+
+// empty string
+#define str_sso_null ((str_sso){ 0 })
+
+// maximum length of an inline string (without null terminator)
+#define STR_SSO_CAP	(sizeof(str) - 2)
+
+// helper macro (not for general use): the tag byte overlaps the most significant byte of
+// the heap string length on little-endian platforms, and the least significant byte otherwise
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	#define str_sso_shift	8
+#else
+	#define str_sso_shift	0
+#endif
+
+// test if the string is stored inline
+static inline
+bool str_sso_is_small(const str_sso* const s) { return s->small.tag != 0; }
+
+// create a reference to the string; the reference is valid while the object is unchanged
+static inline
+str str_sso_ref(const str_sso* const s) {
+	return str_sso_is_small(s)
+		? str_ref_mem(s->small.data, s->small.tag & 0x7F)
+		: str_ref((str){ s->heap.ptr, s->heap.prop >> str_sso_shift });
+}
+
+// length of the string
+static inline
+size_t str_sso_len(const str_sso* const s) { return str_len(str_sso_ref(s)); }
+
+// pointer to the string
+static inline
+const char* str_sso_ptr(const str_sso* const s) { return str_ptr(str_sso_ref(s)); }
+
+// free memory allocated for the string
+static inline
+void str_sso_free(const str_sso s) {
+	if(!str_sso_is_small(&s))
+		str_free((str){ s.heap.ptr, s.heap.prop >> str_sso_shift });
+}
+
+// clear string
+static inline
+void str_sso_clear(str_sso* const s) {
+	str_sso_free(*s);
+	*s = str_sso_null;
+}
+
+// assign a copy of the given string
+void str_sso_clone(str_sso* const dest, const str s);
+
+// compare two strings
+static inline
+int str_sso_cmp(const str_sso* const s1, const str_sso* const s2) {
+	return str_cmp(str_sso_ref(s1), str_sso_ref(s2));
+}
+
+// test if the two strings match
+static inline
+bool str_sso_eq(const str_sso* const s1, const str_sso* const s2) {
+	// inline strings are zero-padded, so they can be compared as a whole
+	if(str_sso_is_small(s1) && str_sso_is_small(s2))
+		return memcmp(s1, s2, sizeof(str_sso)) == 0;
+
+	return str_eq(str_sso_ref(s1), str_sso_ref(s2));
+}
+
+// comparison functions for sorting
+int str_sso_order_asc(const void* const s1, const void* const s2);
+int str_sso_order_desc(const void* const s1, const void* const s2);
+
+// sort array
+static inline
+void str_sso_sort_array(const str_cmp_func cmp, const str_sso* const array, const size_t count) {
+	if(array && count > 1)
+		qsort((void*)array, count, sizeof(array[0]), cmp);
+}
+
+// statistics -------------------------------------------------------------------------------------
+#ifdef STR_STATS
+
+// functions with statistics
+#define STR_STATS_FUNCTIONS(X)	\
+	X(str_hash)	\
+	X(str_sprintf)	\
+	X(str_clone)	\
+	X(str_share)	\
+	X(str_concat_array)	\
+	X(str_join_array)	\
+	X(str_repeat)	\
+	X(str_set_allocator)	\
+	X(str_set_thread_allocator)	\
+	X(str_get_allocator)	\
+	X(str_pool_set_limit)	\
+	X(str_pool_trim)	\
+	X(str_builder_free)	\
+	X(str_builder_reserve)	\
+	X(str_builder_append_mem)	\
+	X(str_builder_append_codepoint)	\
+	X(str_builder_finish)	\
+	X(str_arena_init)	\
+	X(str_arena_reset)	\
+	X(str_arena_free)	\
+	X(str_arena_clone)	\
+	X(str_arena_concat_array)	\
+	X(str_arena_join_array)	\
+	X(str_arena_sprintf)	\
+	X(str_arena_replace_substring)	\
+	X(str_arena_replace_chars)	\
+	X(str_arena_replace_char_spans)	\
+	X(str_charset_init)	\
+	X(str_finder_init)	\
+	X(str_finder_first)	\
+	X(str_finder_next)	\
+	X(str_finder_last)	\
+	X(str_matcher_init)	\
+	X(str_matcher_find)	\
+	X(str_matcher_find_overlapping)	\
+	X(str_matcher_free)	\
+	X(str_span_chars)	\
+	X(str_span_chars_cs)	\
+	X(str_span_nonmatching_chars)	\
+	X(str_span_nonmatching_chars_cs)	\
+	X(str_span_until_substring)	\
+	X(str_span_trailing_chars)	\
+	X(str_span_trailing_chars_cs)	\
+	X(str_span_trailing_nonmatching_chars)	\
+	X(str_span_trailing_nonmatching_chars_cs)	\
+	X(str_span_until_last_substring)	\
+	X(str_find_all_substring)	\
+	X(str_finder_find_all)	\
+	X(str_find_all_chars)	\
+	X(str_find_all_chars_cs)	\
+	X(str_count_byte)	\
+	X(str_count_chars)	\
+	X(str_count_chars_cs)	\
+	X(str_count_substring)	\
+	X(str_line_index_init)	\
+	X(str_line_index_free)	\
+	X(str_line_index_update)	\
+	X(str_line_index_get)	\
+	X(str_line_index_count)	\
+	X(str_split_init)	\
+	X(str_split_init_substring)	\
+	X(str_split_next)	\
+	X(str_split_array)	\
+	X(str_replace_substring)	\
+	X(str_replace_table_init)	\
+	X(str_replace_table_free)	\
+	X(str_replace_map)	\
+	X(str_replace_chars)	\
+	X(str_replace_chars_cs)	\
+	X(str_replace_char_spans)	\
+	X(str_replace_char_spans_cs)	\
+	X(str_span_valid_utf8)	\
+	X(str_count_codepoints)	\
+	X(str_to_valid_utf8)	\
+	X(str_encode_codepoint)	\
+	X(str_utf8_decoder_init)	\
+	X(str_decode_utf8_array)	\
+	X(str_utf8_to_utf16)	\
+	X(str_utf16_to_utf8)	\
+	X(str_utf8_to_utf32)	\
+	X(str_utf32_to_utf8)	\
+	X(str_concat_array_to_stream)	\
+	X(str_concat_array_to_fd)	\
+	X(str_read_all_file)	\
+	X(str_get_line)	\
+	X(str_order_asc)	\
+	X(str_order_desc)	\
+	X(str_partition_array)	\
+	X(str_unique_partition_array)	\
+	X(str_sso_clone)	\
+	X(str_sso_order_asc)	\
+	X(str_sso_order_desc)
+
+// function identifiers
+typedef enum {
+	str_stats_other,	// allocations made outside of any library call
+#define STR_STATS_ID(fn)	str_stats_##fn,
+	STR_STATS_FUNCTIONS(STR_STATS_ID)
+#undef STR_STATS_ID
+	STR_STATS_COUNT
+} str_stats_id;
+
+// counters
+typedef struct {
+	uint64_t calls, bytes_in, bytes_out, allocs, reallocs, bytes_allocated;
+} str_stats_counters;
+
+// allocation categories
+#define STR_STATS_CATEGORIES(X)	\
+	X(clone)	\
+	X(concat)	\
+	X(join)	\
+	X(repeat)	\
+	X(sprintf)	\
+	X(read_all_file)	\
+	X(get_line)	\
+	X(replace)	\
+	X(other)
+
+typedef enum {
+#define STR_STATS_CATEGORY_ID(cat)	str_stats_cat_##cat,
+	STR_STATS_CATEGORIES(STR_STATS_CATEGORY_ID)
+#undef STR_STATS_CATEGORY_ID
+	STR_STATS_CAT_COUNT
+} str_stats_category;
+
+// histogram of allocation request sizes, with bucket `i` counting sizes in range [2^i, 2^(i+1))
+#define STR_STATS_BUCKETS	64
+
+typedef struct {
+	uint64_t hist[STR_STATS_BUCKETS];
+	uint64_t max_request;
+} str_stats_sizes;
+
+typedef struct {
+	str_stats_counters fn[STR_STATS_COUNT];
+	str_stats_sizes sizes[STR_STATS_CAT_COUNT];
+} str_stats;
+
+// copy the counters of the calling thread
+void str_stats_snapshot(str_stats* const dest);
+
+// add counters from `src` to `dest`
+void str_stats_merge(str_stats* const dest, const str_stats* const src);
+
+// reset the counters of the calling thread
+void str_stats_reset(void);
+
+// write counters as text, returning 0 or errno
+int str_stats_dump(FILE* const stream, const str_stats* const stats);
+
+// process-wide number of bytes currently allocated by the library, and its high-water mark
+int64_t str_stats_live_bytes(void);
+int64_t str_stats_peak_bytes(void);
+
+// reset the high-water mark to the current number of live bytes
+void str_stats_reset_peak(void);
+
+#endif	// STR_STATS
+
 #ifdef __cplusplus
 }
 #endif